@@ -2,6 +2,7 @@
 #include <sstream>
 
 #include "Array.h"
+#include "Memory.h"
 #include "exceptions.h"
 
 using namespace std;
@@ -11,11 +12,15 @@ bool Array::allocateMemory( RealType* & data, const IndexType & size )
     data = new RealType[ size ];
     if( ! data )
         return false;
+    Memory::allocate( Memory::VECTORS, size * sizeof( RealType ) );
     return true;
 }
 
+// data must be the storage of this array, its size is still in this->size
 bool Array::freeMemory( RealType* & data )
 {
+    if( data )
+        Memory::release( Memory::VECTORS, size * sizeof( RealType ) );
     delete[] data;
     return true;
 }
@@ -90,10 +95,12 @@ bool Array::save( const std::string & file_name ) const
     ofstream file( file_name.c_str() );
     file << "# saved vector:" << endl;
     file << "# <row index> <value>" << endl;
+    // '\n' instead of endl, flushing every line is slow
     for( IndexType i = 0; i < size; i++ ) {
-        file << i << " " << getElement( i ) << endl;
+        file << i << " " << data[ i ] << '\n';
     }
-    return true;
+    file.close();
+    return ! file.fail();
 }
 
 // TODO: check dimensions
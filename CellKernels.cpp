@@ -0,0 +1,152 @@
+#include <immintrin.h>
+
+#include "CellKernels.h"
+
+using namespace std;
+
+
+// scalar variants, also used for the remainders of the vector loops
+
+static void update_pressure_scalar( IndexType count,
+                                    IndexType stride,
+                                    const IndexType* edges,
+                                    const RealType* weights,
+                                    const RealType* shift,
+                                    const RealType* trace,
+                                    RealType* pressure )
+{
+    for( IndexType K = 0; K < count; K++ ) {
+        RealType p = shift[ K ];
+        p += weights[ K ] * trace[ edges[ K ] ];
+        p += weights[ stride + K ] * trace[ edges[ stride + K ] ];
+        p += weights[ 2 * stride + K ] * trace[ edges[ 2 * stride + K ] ];
+        p += weights[ 3 * stride + K ] * trace[ edges[ 3 * stride + K ] ];
+        pressure[ K ] = p;
+    }
+}
+
+static void scale_scalar( IndexType count, RealType factor, const RealType* x, RealType* y )
+{
+    for( IndexType K = 0; K < count; K++ )
+        y[ K ] = factor * x[ K ];
+}
+
+
+// AVX2: 4 cells per iteration, traces are gathered
+// (separate multiply and add to match the rounding of the scalar variant)
+
+__attribute__(( target( "avx2" ) ))
+static void update_pressure_avx2( IndexType count,
+                                  IndexType stride,
+                                  const IndexType* edges,
+                                  const RealType* weights,
+                                  const RealType* shift,
+                                  const RealType* trace,
+                                  RealType* pressure )
+{
+    // masked gathers with a zero source avoid reading an undefined register
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d all = _mm256_castsi256_pd( _mm256_set1_epi64x( -1 ) );
+    const __m128i offsets = _mm_setr_epi32( 0, 1, 2, 3 );
+    IndexType K = 0;
+    for( ; K + 4 <= count; K += 4 ) {
+        __m256d p = _mm256_loadu_pd( shift + K );
+        for( int i = 0; i < 4; i++ ) {
+            const __m128i e = _mm_loadu_si128( (const __m128i*) ( edges + i * stride + K ) );
+            const __m128i consecutive = _mm_add_epi32( _mm_set1_epi32( _mm_cvtsi128_si32( e ) ), offsets );
+            __m256d t;
+            // edges of neighbouring cells in a mesh row are consecutive, avoid the gather
+            if( _mm_movemask_epi8( _mm_cmpeq_epi32( e, consecutive ) ) == 0xffff )
+                t = _mm256_loadu_pd( trace + _mm_cvtsi128_si32( e ) );
+            else
+                t = _mm256_mask_i32gather_pd( zero, trace, e, all, 8 );
+            const __m256d w = _mm256_loadu_pd( weights + i * stride + K );
+            p = _mm256_add_pd( p, _mm256_mul_pd( w, t ) );
+        }
+        _mm256_storeu_pd( pressure + K, p );
+    }
+    update_pressure_scalar( count - K, stride, edges + K, weights + K, shift + K, trace, pressure + K );
+}
+
+__attribute__(( target( "avx2" ) ))
+static void scale_avx2( IndexType count, RealType factor, const RealType* x, RealType* y )
+{
+    const __m256d f = _mm256_set1_pd( factor );
+    IndexType K = 0;
+    for( ; K + 4 <= count; K += 4 )
+        _mm256_storeu_pd( y + K, _mm256_mul_pd( f, _mm256_loadu_pd( x + K ) ) );
+    scale_scalar( count - K, factor, x + K, y + K );
+}
+
+
+// AVX-512: 8 cells per iteration
+
+__attribute__(( target( "avx512f,avx2" ) ))
+static void update_pressure_avx512( IndexType count,
+                                    IndexType stride,
+                                    const IndexType* edges,
+                                    const RealType* weights,
+                                    const RealType* shift,
+                                    const RealType* trace,
+                                    RealType* pressure )
+{
+    const __m512d zero = _mm512_setzero_pd();
+    const __m256i offsets = _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 );
+    IndexType K = 0;
+    for( ; K + 8 <= count; K += 8 ) {
+        __m512d p = _mm512_loadu_pd( shift + K );
+        for( int i = 0; i < 4; i++ ) {
+            const __m256i e = _mm256_loadu_si256( (const __m256i*) ( edges + i * stride + K ) );
+            const __m256i consecutive = _mm256_add_epi32( _mm256_set1_epi32( edges[ i * stride + K ] ), offsets );
+            __m512d t;
+            if( _mm256_movemask_epi8( _mm256_cmpeq_epi32( e, consecutive ) ) == -1 )
+                t = _mm512_loadu_pd( trace + edges[ i * stride + K ] );
+            else
+                t = _mm512_mask_i32gather_pd( zero, 0xff, e, trace, 8 );
+            const __m512d w = _mm512_loadu_pd( weights + i * stride + K );
+            p = _mm512_add_pd( p, _mm512_mul_pd( w, t ) );
+        }
+        _mm512_storeu_pd( pressure + K, p );
+    }
+    update_pressure_scalar( count - K, stride, edges + K, weights + K, shift + K, trace, pressure + K );
+}
+
+__attribute__(( target( "avx512f" ) ))
+static void scale_avx512( IndexType count, RealType factor, const RealType* x, RealType* y )
+{
+    const __m512d f = _mm512_set1_pd( factor );
+    IndexType K = 0;
+    for( ; K + 8 <= count; K += 8 )
+        _mm512_storeu_pd( y + K, _mm512_mul_pd( f, _mm512_loadu_pd( x + K ) ) );
+    scale_scalar( count - K, factor, x + K, y + K );
+}
+
+
+static const CellKernels kernels_scalar = { "scalar", update_pressure_scalar, scale_scalar };
+static const CellKernels kernels_avx2 = { "avx2", update_pressure_avx2, scale_avx2 };
+static const CellKernels kernels_avx512 = { "avx512", update_pressure_avx512, scale_avx512 };
+
+const CellKernels* cell_kernels( const string & isa )
+{
+    __builtin_cpu_init();
+    if( isa == "scalar" )
+        return &kernels_scalar;
+    if( isa == "avx2" && __builtin_cpu_supports( "avx2" ) )
+        return &kernels_avx2;
+    if( isa == "avx512" && __builtin_cpu_supports( "avx512f" ) && __builtin_cpu_supports( "avx2" ) )
+        return &kernels_avx512;
+    return nullptr;
+}
+
+const CellKernels & cell_kernels( void )
+{
+    static const CellKernels* best = [] () {
+        for( const char* isa : { "avx512", "avx2" } ) {
+            const CellKernels* kernels = cell_kernels( isa );
+            if( kernels )
+                return kernels;
+        }
+        return &kernels_scalar;
+    } ();
+    return *best;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+// TODO: required only for IndexType and RealType
+#include "Matrix.h"
+
+// Per-cell kernels of the Solver operating on contiguous arrays in the
+// structure-of-arrays layout (component i of cell K at [i * stride + K]).
+// The kernels process `count` cells starting at the passed pointers, so a
+// range of cells is handled by offsetting all per-cell pointers.
+// Every instruction set performs the same operations in the same order,
+// so all variants give bitwise identical results.
+struct CellKernels
+{
+    const char* isa;
+
+    // pressure[K] = shift[K] + sum_i weights[i*stride+K] * trace[edges[i*stride+K]]
+    void (*update_pressure)( IndexType count,
+                             IndexType stride,
+                             const IndexType* edges,
+                             const RealType* weights,
+                             const RealType* shift,
+                             const RealType* trace,
+                             RealType* pressure );
+
+    // y[K] = factor * x[K]
+    void (*scale)( IndexType count, RealType factor, const RealType* x, RealType* y );
+};
+
+// the best variant supported by the running CPU
+const CellKernels & cell_kernels( void );
+
+// variant for given instruction set ("scalar", "avx2", "avx512"),
+// nullptr if unknown or not supported by the running CPU
+const CellKernels* cell_kernels( const std::string & isa );
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "Ensemble.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+using namespace std;
+
+namespace {
+
+// parse the value of key=value into the corresponding field
+bool parse_value( const string & key, const string & value, Scenario & scenario )
+{
+    stringstream ss( value );
+    SolverOptions & options = scenario.options;
+    if( key == "time-step-order" )
+        ss >> scenario.time_step_order;
+    else if( key == "permeability" )
+        ss >> options.permeability;
+    else if( key == "porosity" )
+        ss >> options.porosity;
+    else if( key == "dirichlet-base" )
+        ss >> options.dirichlet_base;
+    else if( key == "dirichlet-gradient" )
+        ss >> options.dirichlet_gradient;
+    else if( key == "integrator" )
+        ss >> options.integrator;
+    else if( key == "nonlinear" )
+        ss >> options.nonlinear;
+    else if( key == "adaptive-tolerance" )
+        ss >> options.adaptive_tolerance;
+    else if( key == "steady-tolerance" )
+        ss >> options.steady_tolerance;
+    else
+        return false;
+    return ! ss.fail();
+}
+
+} // namespace
+
+bool load_scenarios( const string & file_name,
+                     const SolverOptions & defaults,
+                     vector< Scenario > & scenarios )
+{
+    ifstream file( file_name.c_str() );
+    if( file.fail() ) {
+        cerr << "Unable to open the scenario file " << file_name << "." << endl;
+        return false;
+    }
+
+    string line;
+    unsigned line_number = 0;
+    while( getline( file, line ) ) {
+        line_number++;
+        stringstream ss( line );
+        Scenario scenario;
+        scenario.options = defaults;
+        if( ! ( ss >> scenario.name ) || scenario.name[ 0 ] == '#' )
+            continue;
+        ss >> scenario.size_x >> scenario.size_y >> scenario.time_step;
+        if( ss.fail() || scenario.size_x <= 0 || scenario.size_y <= 0 || scenario.time_step <= 0.0 ) {
+            cerr << file_name << ":" << line_number << ": expected name, positive size-x, size-y and time-step" << endl;
+            return false;
+        }
+
+        string item;
+        while( ss >> item ) {
+            const size_t separator = item.find( '=' );
+            if( separator == string::npos || ! parse_value( item.substr( 0, separator ), item.substr( separator + 1 ), scenario ) ) {
+                cerr << file_name << ":" << line_number << ": invalid parameter '" << item << "'" << endl;
+                return false;
+            }
+        }
+
+        // the output of concurrent instances would be interleaved
+        scenario.options.verbose = false;
+        scenario.options.telemetry_file = "";
+        scenarios.push_back( scenario );
+    }
+    return true;
+}
+
+bool run_ensemble( const vector< Scenario > & scenarios,
+                   const string & output_prefix,
+                   unsigned threads,
+                   size_t memory_budget )
+{
+    mutex output_lock;
+    unsigned failed = 0;
+    unsigned skipped = 0;
+
+    // the largest scenarios first, the small ones then fill the gaps
+    vector< size_t > order( scenarios.size() );
+    vector< size_t > memory( scenarios.size() );
+    for( size_t i = 0; i < scenarios.size(); i++ ) {
+        order[ i ] = i;
+        memory[ i ] = Solver::estimate_memory( scenarios[ i ].size_x, scenarios[ i ].size_y, scenarios[ i ].options );
+    }
+    stable_sort( order.begin(), order.end(), [&memory] ( size_t a, size_t b ) { return memory[ a ] > memory[ b ]; } );
+
+    auto start = chrono::steady_clock::now();
+    ThreadPool pool( threads );
+    for( size_t i : order ) {
+        pool.submit( [&, i] ( unsigned worker ) {
+            const Scenario & scenario = scenarios[ i ];
+            if( memory_budget > 0 && memory[ i ] > memory_budget ) {
+                lock_guard< mutex > guard( output_lock );
+                cerr << "Scenario " << scenario.name << " skipped: estimated memory " << memory[ i ] / 1024 / 1024
+                     << " MiB exceeds the per-thread budget of " << memory_budget / 1024 / 1024 << " MiB." << endl;
+                skipped++;
+                return;
+            }
+
+            auto scenario_start = chrono::steady_clock::now();
+            bool status;
+            {
+                Trace::Scope trace( "scenario" );
+                Solver solver( output_prefix + "-" + scenario.name,
+                               scenario.size_x, scenario.size_y,
+                               scenario.time_step, scenario.time_step_order,
+                               scenario.options );
+                status = solver.run();
+            }
+            auto scenario_stop = chrono::steady_clock::now();
+
+            lock_guard< mutex > guard( output_lock );
+            if( ! status )
+                failed++;
+            cout << "Scenario " << scenario.name << " (" << scenario.size_x << "x" << scenario.size_y
+                 << ", worker " << worker << "): " << ( status ? "finished" : "failed" ) << " in "
+                 << chrono::duration< double >( scenario_stop - scenario_start ).count() << " s" << endl;
+        } );
+    }
+    pool.wait();
+    auto stop = chrono::steady_clock::now();
+
+    cout << "Ensemble: " << scenarios.size() << " scenarios on " << pool.size() << " threads in "
+         << chrono::duration< double >( stop - start ).count() << " s, "
+         << failed << " failed, " << skipped << " skipped, " << pool.steals() << " stolen tasks" << endl;
+    return failed == 0 && skipped == 0;
+}
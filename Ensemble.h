@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Solver.h"
+
+// One scenario of an ensemble run. The scenario file has one scenario per
+// line (empty lines and lines starting with '#' are ignored):
+//     name size-x size-y time-step [key=value ...]
+// where the optional keys are time-step-order, permeability, porosity,
+// dirichlet-base, dirichlet-gradient, integrator, nonlinear,
+// adaptive-tolerance and steady-tolerance.
+struct Scenario
+{
+    std::string name;
+    IndexType size_x = 0;
+    IndexType size_y = 0;
+    RealType time_step = 0.0;
+    RealType time_step_order = 0.0;
+    SolverOptions options;
+};
+
+// Append the scenarios from a file, options not given in the file are taken
+// from `defaults`.
+bool load_scenarios( const std::string & file_name,
+                     const SolverOptions & defaults,
+                     std::vector< Scenario > & scenarios );
+
+// Run independent Solver instances for the scenarios concurrently on a
+// work-stealing thread pool. Snapshots of a scenario are written with the
+// prefix <output_prefix>-<name>. Scenarios whose estimated memory exceeds
+// the per-thread budget (in bytes, zero means unlimited) are not run.
+// Instances on the same mesh share the topology and the symbolic
+// factorization. Returns true if all scenarios succeeded.
+bool run_ensemble( const std::vector< Scenario > & scenarios,
+                   const std::string & output_prefix,
+                   unsigned threads,
+                   size_t memory_budget );
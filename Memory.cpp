@@ -0,0 +1,119 @@
+#include <atomic>
+#include <cstdint>
+
+#include "Memory.h"
+
+using namespace std;
+
+namespace {
+
+// the last element of the arrays is the total of all tags
+atomic< int64_t > live_bytes[ Memory::NUM_TAGS + 1 ];
+atomic< int64_t > peak_bytes[ Memory::NUM_TAGS + 1 ];
+atomic< int64_t > phase_peak_bytes[ Memory::MAX_PHASES ][ Memory::NUM_TAGS + 1 ];
+atomic< bool > phase_used[ Memory::MAX_PHASES ];
+thread_local int current_phase = -1;
+
+void update_max( atomic< int64_t > & target, int64_t value )
+{
+    int64_t old = target.load( memory_order_relaxed );
+    while( value > old && ! target.compare_exchange_weak( old, value, memory_order_relaxed ) )
+        ;
+}
+
+void update_peaks( int tag, int64_t live, int64_t total )
+{
+    update_max( peak_bytes[ tag ], live );
+    update_max( peak_bytes[ Memory::NUM_TAGS ], total );
+    const int phase = current_phase;
+    if( phase >= 0 ) {
+        update_max( phase_peak_bytes[ phase ][ tag ], live );
+        update_max( phase_peak_bytes[ phase ][ Memory::NUM_TAGS ], total );
+    }
+}
+
+size_t nonnegative( int64_t bytes )
+{
+    return ( bytes > 0 ) ? bytes : 0;
+}
+
+} // namespace
+
+const char* Memory::tag_name( Tag tag )
+{
+    static const char* names[ NUM_TAGS ] = {
+        "vectors",
+        "CSR arrays",
+        "UMFPACK symbolic",
+        "UMFPACK numeric",
+        "UMFPACK workspace",
+    };
+    return names[ tag ];
+}
+
+void Memory::allocate( Tag tag, size_t bytes )
+{
+    if( bytes == 0 )
+        return;
+    const int64_t live = live_bytes[ tag ].fetch_add( bytes, memory_order_relaxed ) + bytes;
+    const int64_t total = live_bytes[ NUM_TAGS ].fetch_add( bytes, memory_order_relaxed ) + bytes;
+    update_peaks( tag, live, total );
+}
+
+void Memory::release( Tag tag, size_t bytes )
+{
+    live_bytes[ tag ].fetch_sub( bytes, memory_order_relaxed );
+    live_bytes[ NUM_TAGS ].fetch_sub( bytes, memory_order_relaxed );
+}
+
+size_t Memory::live( Tag tag )
+{
+    return nonnegative( live_bytes[ tag ].load( memory_order_relaxed ) );
+}
+
+size_t Memory::peak( Tag tag )
+{
+    return nonnegative( peak_bytes[ tag ].load( memory_order_relaxed ) );
+}
+
+size_t Memory::total_live( void )
+{
+    return nonnegative( live_bytes[ NUM_TAGS ].load( memory_order_relaxed ) );
+}
+
+size_t Memory::total_peak( void )
+{
+    return nonnegative( peak_bytes[ NUM_TAGS ].load( memory_order_relaxed ) );
+}
+
+int Memory::set_phase( int phase )
+{
+    if( phase >= MAX_PHASES )
+        phase = -1;
+    if( phase >= 0 ) {
+        // the memory held when the phase starts counts towards its peak
+        phase_used[ phase ].store( true, memory_order_relaxed );
+        for( int tag = 0; tag <= NUM_TAGS; tag++ )
+            update_max( phase_peak_bytes[ phase ][ tag ], live_bytes[ tag ].load( memory_order_relaxed ) );
+    }
+    const int previous = current_phase;
+    current_phase = phase;
+    return previous;
+}
+
+int Memory::get_phase( void )
+{
+    return current_phase;
+}
+
+size_t Memory::phase_peak( int phase, int tag )
+{
+    if( phase < 0 || phase >= MAX_PHASES || tag < 0 || tag > NUM_TAGS )
+        return 0;
+    return nonnegative( phase_peak_bytes[ phase ][ tag ].load( memory_order_relaxed ) );
+}
+
+bool Memory::phase_entered( int phase )
+{
+    return phase >= 0 && phase < MAX_PHASES && phase_used[ phase ].load( memory_order_relaxed );
+}
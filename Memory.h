@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+// Accounting of the memory allocated by the data structures of the solver.
+// The allocations register their bytes under a tag; live and peak bytes are
+// kept per tag and, for the phase entered by set_phase(), peak bytes per
+// phase. The phase is set per thread, so concurrent solvers (ensembles) do
+// not overwrite each other's phases; the counters are process-wide atomics,
+// so with several solvers in one process they describe all of them together.
+class Memory
+{
+public:
+    enum Tag {
+        VECTORS,            // Array data (Vectors of the solver and of the linear solvers)
+        CSR,                // value and index arrays of the sparse matrices
+        UMFPACK_SYMBOLIC,   // symbolic factorizations and their patterns kept in the symbolic cache
+        UMFPACK_NUMERIC,    // numeric factorizations
+        UMFPACK_WORKSPACE,  // temporary memory of the factorizations beyond the factors
+        NUM_TAGS
+    };
+
+    // phases are numbered by the caller (see Profiler::Phase)
+    static const int MAX_PHASES = 16;
+
+    static const char* tag_name( Tag tag );
+
+    static void allocate( Tag tag, size_t bytes );
+    static void release( Tag tag, size_t bytes );
+    // memory used only during a call, e.g. the workspace reported by UMFPACK
+    static void temporary( Tag tag, size_t bytes ) { allocate( tag, bytes ); release( tag, bytes ); };
+
+    static size_t live( Tag tag );
+    static size_t peak( Tag tag );
+    static size_t total_live( void );
+    static size_t total_peak( void );
+
+    // phase of the following allocations of the calling thread (-1 for
+    // none), returns the previous one
+    static int set_phase( int phase );
+    static int get_phase( void );
+    // peak bytes of a tag, or of the total with tag == NUM_TAGS, while the phase was set
+    static size_t phase_peak( int phase, int tag );
+    static bool phase_entered( int phase );
+};
@@ -0,0 +1,113 @@
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "PerfCounters.h"
+
+using namespace std;
+
+namespace {
+
+struct CounterType
+{
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+const CounterType counter_types[ PerfCounters::MAX_COUNTERS ] = {
+    { "cycles",       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "task-clock",   PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { "page-faults",  PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+int perf_event_open( const CounterType & counter, bool inherit )
+{
+    perf_event_attr attr;
+    memset( &attr, 0, sizeof( attr ) );
+    attr.size = sizeof( attr );
+    attr.type = counter.type;
+    attr.config = counter.config;
+    attr.inherit = inherit;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // this thread (and its future children if inherited), any CPU
+    return syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+// value of a counter, scaled when the kernel multiplexes it
+uint64_t read_counter( int fd )
+{
+    // value, time enabled, time running
+    uint64_t data[ 3 ] = { 0, 0, 0 };
+    if( fd < 0 || ::read( fd, data, sizeof( data ) ) != sizeof( data ) || data[ 2 ] == 0 )
+        return 0;
+    if( data[ 2 ] < data[ 1 ] )
+        return (uint64_t) ( (double) data[ 0 ] * data[ 1 ] / data[ 2 ] );
+    return data[ 0 ];
+}
+
+} // namespace
+
+PerfCounters::~PerfCounters( void )
+{
+    for( int i = 0; i < count; i++ )
+        close( fds[ i ] );
+    for( int fd : thread_fds )
+        close( fd );
+}
+
+bool PerfCounters::open( void )
+{
+    for( const CounterType & counter : counter_types ) {
+        const int fd = perf_event_open( counter, true );
+        if( fd < 0 )
+            continue;
+        fds[ count ] = fd;
+        names[ count ] = counter.name;
+        count++;
+    }
+    return count > 0;
+}
+
+int PerfCounters::find( const char* name ) const
+{
+    for( int i = 0; i < count; i++ ) {
+        if( strcmp( names[ i ], name ) == 0 )
+            return i;
+    }
+    return -1;
+}
+
+bool PerfCounters::attach_thread( void )
+{
+    bool status = true;
+    vector< int > opened;
+    for( int i = 0; i < count; i++ ) {
+        int fd = -1;
+        for( const CounterType & counter : counter_types ) {
+            if( strcmp( counter.name, names[ i ] ) == 0 )
+                fd = perf_event_open( counter, false );
+        }
+        // a missing counter of this thread reads as zero
+        status &= fd >= 0;
+        opened.push_back( fd );
+    }
+    lock_guard< mutex > guard( lock );
+    thread_fds.insert( thread_fds.end(), opened.begin(), opened.end() );
+    return status;
+}
+
+void PerfCounters::read( uint64_t* values ) const
+{
+    for( int i = 0; i < count; i++ )
+        values[ i ] = read_counter( fds[ i ] );
+    lock_guard< mutex > guard( lock );
+    for( size_t k = 0; k < thread_fds.size(); k++ )
+        values[ k % count ] += read_counter( thread_fds[ k ] );
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Counters of the calling thread and of the threads it creates afterwards
+// (folded into the counts when they exit) plus the counters of the attached
+// threads, read through the Linux perf_event_open interface. Hardware counters
+// (cycles, instructions, cache misses) are used when the PMU is accessible,
+// software counters (task clock, page faults) are opened in any case; only
+// user-space events are counted, which works with the default
+// perf_event_paranoid setting.
+class PerfCounters
+{
+public:
+    static const int MAX_COUNTERS = 5;
+
+    PerfCounters( void ) = default;
+    ~PerfCounters( void );
+
+    PerfCounters( const PerfCounters & ) = delete;
+    PerfCounters & operator=( const PerfCounters & ) = delete;
+
+    // open the available counters, false if none of them is available
+    bool open( void );
+    // open the same counters for the calling thread, which are added to the
+    // values of read(); for long-lived workers (e.g. of a ThreadPool), whose
+    // inherited counts would appear only when they exit
+    bool attach_thread( void );
+
+    int size( void ) const { return count; };
+    const char* name( int i ) const { return names[ i ]; };
+    // index of the counter with given name, -1 if it is not open
+    int find( const char* name ) const;
+
+    // current values of the counters (scaled when the kernel multiplexes them)
+    void read( uint64_t* values ) const;
+
+private:
+    int fds[ MAX_COUNTERS ];
+    const char* names[ MAX_COUNTERS ];
+    int count = 0;
+    // counters of the attached threads, `count` descriptors per thread
+    mutable std::mutex lock;
+    std::vector< int > thread_fds;
+};
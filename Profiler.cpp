@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "Profiler.h"
+
+using namespace std;
+
+static_assert( Profiler::NUM_PHASES <= Memory::MAX_PHASES, "Memory does not track all phases" );
+
+const char* Profiler::phase_name( Phase phase )
+{
+    static const char* names[ NUM_PHASES ] = {
+        "allocation",
+        "auxiliary vectors",
+        "assembly",
+        "symbolic",
+        "numeric",
+        "solve",
+        "pressure update",
+        "fused sweep",
+        "snapshot",
+    };
+    return names[ phase ];
+}
+
+string Profiler::field_name( Phase phase )
+{
+    string name = phase_name( phase );
+    replace( name.begin(), name.end(), ' ', '_' );
+    return name;
+}
+
+bool Profiler::enable_counters( void )
+{
+    counters.reset( new PerfCounters );
+    if( ! counters->open() ) {
+        counters.reset();
+        return false;
+    }
+    for( auto & sums : counter_sums )
+        sums.assign( counters->size(), 0 );
+    return true;
+}
+
+void Profiler::record_counters( Phase phase, const uint64_t* start )
+{
+    uint64_t stop[ PerfCounters::MAX_COUNTERS ];
+    counters->read( stop );
+    for( int i = 0; i < counters->size(); i++ )
+        counter_sums[ phase ][ i ] += stop[ i ] - start[ i ];
+}
+
+void Profiler::report( ostream & os ) const
+{
+    double sum = 0.0;
+    for( int phase = 0; phase < NUM_PHASES; phase++ )
+        sum += total( (Phase) phase );
+
+    const ios::fmtflags flags = os.flags();
+    const streamsize precision = os.precision();
+    os << "Profile (times of one call in ms):" << endl;
+    os << "  " << left << setw( 18 ) << "phase" << right << setw( 8 ) << "count" << setw( 11 ) << "total [s]"
+       << setw( 7 ) << "%" << setw( 10 ) << "mean" << setw( 10 ) << "min" << setw( 10 ) << "p50"
+       << setw( 10 ) << "p90" << setw( 10 ) << "p99" << setw( 10 ) << "max" << endl;
+    for( int p = 0; p < NUM_PHASES; p++ ) {
+        const Phase phase = (Phase) p;
+        if( samples[ phase ].empty() )
+            continue;
+        vector< double > sorted = samples[ phase ];
+        sort( sorted.begin(), sorted.end() );
+        auto percentile = [&sorted] ( double q ) {
+            return 1e3 * sorted[ min( sorted.size() - 1, (size_t) ( q * sorted.size() ) ) ];
+        };
+        const double phase_total = total( phase );
+        os << "  " << left << setw( 18 ) << phase_name( phase ) << right << setw( 8 ) << sorted.size()
+           << fixed << setprecision( 3 ) << setw( 11 ) << phase_total
+           << setprecision( 1 ) << setw( 7 ) << ( sum > 0.0 ? 100.0 * phase_total / sum : 0.0 )
+           << setprecision( 3 ) << setw( 10 ) << 1e3 * phase_total / sorted.size()
+           << setw( 10 ) << 1e3 * sorted.front() << setw( 10 ) << percentile( 0.5 )
+           << setw( 10 ) << percentile( 0.9 ) << setw( 10 ) << percentile( 0.99 )
+           << setw( 10 ) << 1e3 * sorted.back() << endl;
+    }
+    if( counters )
+        report_counters( os );
+    report_memory( os );
+    os.flags( flags );
+    os.precision( precision );
+}
+
+// Totals of the counters per phase; with hardware counters also instructions
+// per cycle and cache misses per 1000 instructions. A low IPC together with
+// many misses indicates a memory-bound phase.
+void Profiler::report_counters( ostream & os ) const
+{
+    const int cycles = counters->find( "cycles" );
+    const int instructions = counters->find( "instructions" );
+    const int misses = counters->find( "cache-misses" );
+    const bool derived = cycles >= 0 && instructions >= 0;
+
+    os << "Performance counters (user space, task-clock in ns):" << endl;
+    os << "  " << left << setw( 18 ) << "phase" << right;
+    for( int i = 0; i < counters->size(); i++ )
+        os << setw( 15 ) << counters->name( i );
+    if( derived )
+        os << setw( 8 ) << "IPC";
+    if( derived && misses >= 0 )
+        os << setw( 8 ) << "MPKI";
+    os << endl;
+
+    for( int p = 0; p < NUM_PHASES; p++ ) {
+        const Phase phase = (Phase) p;
+        if( samples[ phase ].empty() )
+            continue;
+        const vector< uint64_t > & sums = counter_sums[ phase ];
+        os << "  " << left << setw( 18 ) << phase_name( phase ) << right;
+        for( int i = 0; i < counters->size(); i++ )
+            os << setw( 15 ) << sums[ i ];
+        os << fixed << setprecision( 2 );
+        if( derived )
+            os << setw( 8 ) << ( sums[ cycles ] > 0 ? (double) sums[ instructions ] / sums[ cycles ] : 0.0 );
+        if( derived && misses >= 0 )
+            os << setw( 8 ) << ( sums[ instructions ] > 0 ? 1e3 * sums[ misses ] / sums[ instructions ] : 0.0 );
+        os << endl;
+    }
+    if( ! derived )
+        os << "  hardware counters are not available, only software events are counted" << endl;
+}
+
+// Live and peak bytes of the memory accounting per tag, and the peak of each
+// tag while a phase was running (including what was allocated before).
+void Profiler::report_memory( ostream & os ) const
+{
+    const double MiB = 1024.0 * 1024.0;
+    os << "Memory (MiB):" << endl;
+    os << "  " << left << setw( 18 ) << "tag" << right << setw( 10 ) << "live" << setw( 10 ) << "peak" << endl;
+    os << fixed << setprecision( 2 );
+    for( int t = 0; t < Memory::NUM_TAGS; t++ ) {
+        const Memory::Tag tag = (Memory::Tag) t;
+        os << "  " << left << setw( 18 ) << Memory::tag_name( tag ) << right
+           << setw( 10 ) << Memory::live( tag ) / MiB << setw( 10 ) << Memory::peak( tag ) / MiB << endl;
+    }
+    os << "  " << left << setw( 18 ) << "total" << right
+       << setw( 10 ) << Memory::total_live() / MiB << setw( 10 ) << Memory::total_peak() / MiB << endl;
+
+    os << "Peak memory per phase (MiB):" << endl;
+    os << "  " << left << setw( 18 ) << "phase" << right;
+    for( int t = 0; t < Memory::NUM_TAGS; t++ )
+        os << setw( 19 ) << Memory::tag_name( (Memory::Tag) t );
+    os << setw( 10 ) << "total" << endl;
+    for( int phase = 0; phase < NUM_PHASES; phase++ ) {
+        if( ! Memory::phase_entered( phase ) )
+            continue;
+        os << "  " << left << setw( 18 ) << phase_name( (Phase) phase ) << right;
+        for( int tag = 0; tag <= Memory::NUM_TAGS; tag++ )
+            os << setw( tag < Memory::NUM_TAGS ? 19 : 10 ) << Memory::phase_peak( phase, tag ) / MiB;
+        os << endl;
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Memory.h"
+#include "PerfCounters.h"
+#include "Trace.h"
+
+// Wall-clock time of the phases of the Solver time loop. Every measured
+// interval is kept, so that the summary can show percentiles; a scope costs
+// two reads of the steady clock. The scopes are also recorded as trace
+// events when the Trace is enabled. Optionally the performance counters are
+// read at both ends of a scope and accumulated per phase. Allocations made
+// inside a scope are accounted to its phase by Memory.
+class Profiler
+{
+public:
+    enum Phase {
+        ALLOCATION,     // setSize/reserve of the vectors and the main matrix
+        AUXILIARY,      // update_auxiliary_vectors
+        ASSEMBLY,       // update_main_system
+        SYMBOLIC,       // symbolic factorization of the main matrix
+        NUMERIC,        // numeric factorization of the main matrix
+        SOLVE,          // solve with the factors (or the iterative solver)
+        PRESSURE,       // update_pressure
+        FUSED,          // fused_sweep
+        SNAPSHOT,       // saving snapshots
+        NUM_PHASES
+    };
+
+    static const char* phase_name( Phase phase );
+    // phase name with underscores, usable as a JSON key or a CSV column
+    static std::string field_name( Phase phase );
+
+    // measures the time from construction to destruction
+    class Scope
+    {
+    public:
+        Scope( Profiler & profiler, Phase phase )
+            : profiler( profiler ), phase( phase ), memory_phase( Memory::set_phase( phase ) )
+        {
+            if( profiler.counters )
+                profiler.counters->read( counters_start );
+            start = Trace::now();
+        }
+
+        ~Scope( void )
+        {
+            const std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+            profiler.record( phase, std::chrono::duration< double >( stop - start ).count() );
+            if( profiler.counters )
+                profiler.record_counters( phase, counters_start );
+            if( Trace::enabled() )
+                Trace::record( phase_name( phase ), start, stop );
+            Memory::set_phase( memory_phase );
+        }
+
+        Scope( const Scope & ) = delete;
+        Scope & operator=( const Scope & ) = delete;
+
+    private:
+        Profiler & profiler;
+        const Phase phase;
+        const int memory_phase;     // phase of the enclosing scope
+        std::chrono::steady_clock::time_point start;
+        uint64_t counters_start[ PerfCounters::MAX_COUNTERS ];
+    };
+
+    // open the performance counters, false if none is available
+    bool enable_counters( void );
+    const PerfCounters* get_counters( void ) const { return counters.get(); };
+    // count also the calling thread (a long-lived worker) if counters are open
+    void attach_thread( void ) { if( counters ) counters->attach_thread(); };
+    // counter totals of a phase in the order of get_counters()
+    const std::vector< uint64_t > & counter_totals( Phase phase ) const { return counter_sums[ phase ]; };
+
+    void record( Phase phase, double seconds )
+    {
+        samples[ phase ].push_back( seconds );
+        totals[ phase ] += seconds;
+    }
+
+    unsigned count( Phase phase ) const { return samples[ phase ].size(); };
+    double total( Phase phase ) const { return totals[ phase ]; };
+
+    // table with count, total, mean, min, percentiles and max of the phases
+    // measured at least once, followed by the tables of the counters and of
+    // the accounted memory
+    void report( std::ostream & os ) const;
+
+private:
+    std::vector< double > samples[ NUM_PHASES ];
+    double totals[ NUM_PHASES ] = {};
+    std::unique_ptr< PerfCounters > counters;
+    std::vector< uint64_t > counter_sums[ NUM_PHASES ];
+
+    void record_counters( Phase phase, const uint64_t* start );
+    void report_counters( std::ostream & os ) const;
+    void report_memory( std::ostream & os ) const;
+};
@@ -2,7 +2,13 @@
 
 #include "Mesh.h"
 
-class RectangularMesh
+// cell numbering: by rows, left to right
+// edge numbering: by rows, first horizontal and then vertical
+//
+// The class is final and the methods used by the Solver are defined inline,
+// so calls through RectangularMesh (not through Mesh) are resolved and
+// inlined at compile time.
+class RectangularMesh final
     : public Mesh
 {
 private:
@@ -14,25 +20,27 @@ private:
 public:
     void setup( double area_width, double area_height, int rows, int columns );
 
-    virtual int num_edges( void ) const;
-    virtual int num_cells( void ) const;
-    virtual int edges_per_cell( void ) const;
+    virtual int num_edges( void ) const { return 2 * _rows * _cols + _rows + _cols; };
+    virtual int num_cells( void ) const { return _rows * _cols; };
+    virtual int edges_per_cell( void ) const { return 4; };
 
     virtual bool is_inner_edge( int edge ) const;
-    virtual bool is_outer_edge( int edge ) const;
+    virtual bool is_outer_edge( int edge ) const { return !is_inner_edge(edge); };
 
     virtual int edge_for_cell( int cell, int edgeOrder ) const;
     virtual int cell_for_edge( int edge, int cellOrder ) const;
     int get_edge_order( int cell, int edge ) const;
 
-    virtual double cell_volume( int cell ) const;
-    virtual double edge_length( int edge ) const;
+    virtual double cell_volume( int ) const { return _hx * _hy; };
+    virtual double edge_length( int edge ) const { return is_horizontal_edge( edge ) ? _hx : _hy; };
 
+    int get_rows( void ) const { return _rows; };
+    int get_cols( void ) const { return _cols; };
     double get_hx( void ) const { return _hx; };
     double get_hy( void ) const { return _hy; };
 
-    bool is_horizontal_edge( int edge ) const;
-    bool is_vertical_edge( int edge ) const;
+    bool is_horizontal_edge( int edge ) const { return edge < (_rows + 1) * _cols; };
+    bool is_vertical_edge( int edge ) const { return not is_horizontal_edge( edge ); };
 
     // TODO: refactoring (specific to problem)
     bool is_neumann_boundary( int edge ) const;
@@ -41,4 +49,137 @@ public:
     // TODO: refactoring (very specific to problem)
     int num_neumann_edges( void ) const;
     int num_dirichlet_edges( void ) const;
+
+    // Call func( cell, row, col, edges ) for all cells in the order of their
+    // indices, edges[ i ] is the edge of local order i (see edge_for_cell).
+    // The indices are updated incrementally, without divisions.
+    template< typename Function >
+    void for_each_cell( const Function & func ) const;
 };
+
+inline bool RectangularMesh::is_inner_edge( int edge ) const
+{
+    // test horizontal edges
+    if( edge < _cols || (_rows * _cols <= edge && edge < (_rows + 1) * _cols) )
+        return false;
+    // test vertical edges
+    edge -= (_rows + 1) * _cols;
+    if( edge >= 0 && (edge % (_cols + 1) == 0 || edge % (_cols + 1) == _cols) )
+        return false;
+    return true;
+}
+
+/*
+ * int cell - cell index
+ * int edgeOrder - for which edge the index should be returned:
+ *          0 - bottom
+ *          1 - top
+ *          2 - left
+ *          3 - right
+ */
+inline int RectangularMesh::edge_for_cell( int cell, int edgeOrder ) const
+{
+    // start with cell coordinates
+    int row = cell / _cols;
+    int col = cell % _cols;
+
+    // increment for right/top edge
+    if( edgeOrder == 1 )
+        row++;
+    if( edgeOrder == 3 )
+        col++;
+
+    if( edgeOrder < 2 )
+        // top/bottom: index in (_rows+1) by _cols row-major matrix
+        return row * _cols + col;
+    // left/right: index in _rows by (_cols+1) row-major matrix, plus number of horizontal edges
+    return (_rows + 1) * _cols + row * (_cols + 1) + col;
+}
+
+/*
+ * int edge - edge index
+ * int cellOrder - for which adjacent cell the index should be returned:
+ *          0 - bottom/left (horizontal/vertical edge)
+ *          1 - top/right
+ * returns: int >= 0 ... valid cell index
+ *          int  < 0 ... error for outer edge
+ */
+inline int RectangularMesh::cell_for_edge( int edge, int cellOrder ) const
+{
+    int row = 0;
+    int col = 0;
+
+    // horizontal edge
+    if( edge < (_rows + 1) * _cols ) {
+        row = edge / _cols;
+        col = edge % _cols;
+
+        if( cellOrder == 0 )
+            row--;
+
+        // cell index for outer edge might get out of bounds
+        if( row < 0 || row >= _rows )
+            return -1;
+    }
+    // vertical edge
+    else {
+        edge -= (_rows + 1) * _cols;
+        row = edge / (_cols + 1);
+        col = edge % (_cols + 1);
+
+        if( cellOrder == 0 )
+            col--;
+
+        // cell index for outer edge might get out of bounds
+        if( col < 0 || col >= _cols )
+            return -1;
+    }
+
+    return row * _cols + col;
+}
+
+inline bool RectangularMesh::is_neumann_boundary( int edge ) const
+{
+    if( ! is_outer_edge( edge ) )
+        return false;
+    return ! is_dirichlet_boundary( edge );
+}
+
+inline bool RectangularMesh::is_dirichlet_boundary( int edge ) const
+{
+    if( ! is_outer_edge( edge ) )
+        return false;
+//    // bottom border
+//    if( edge < _cols )
+//        return true;
+    // top border
+    if( edge >= _rows * _cols && edge < (_rows + 1) * _cols )
+        return true;
+
+//    // left border
+//    if( is_vertical_edge( edge ) && edge % (_cols + 1) == 0 )
+//        return true;
+//    // right border
+//    if( is_vertical_edge( edge ) && edge % (_cols + 1) == _cols )
+//        return true;
+    return false;
+}
+
+template< typename Function >
+void RectangularMesh::for_each_cell( const Function & func ) const
+{
+    int cell = 0;
+    int edges[ 4 ];
+    for( int row = 0; row < _rows; row++ ) {
+        edges[ 0 ] = row * _cols;
+        edges[ 1 ] = edges[ 0 ] + _cols;
+        edges[ 2 ] = (_rows + 1) * _cols + row * (_cols + 1);
+        edges[ 3 ] = edges[ 2 ] + 1;
+        for( int col = 0; col < _cols; col++ ) {
+            func( cell, row, col, (const int*) edges );
+            cell++;
+            for( int i = 0; i < 4; i++ )
+                edges[ i ]++;
+        }
+    }
+}
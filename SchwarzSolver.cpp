@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+#include "SchwarzSolver.h"
+#include "Trace.h"
+#include "parallel.h"
+
+using namespace std;
+
+// unknowns per block of the vector operations of GMRES
+static const IndexType block_size = 8192;
+
+SchwarzSolver::SchwarzSolver( RealType tolerance, unsigned max_iterations, unsigned restart )
+    : tolerance( tolerance ),
+      max_iterations( max_iterations ),
+      restart( restart )
+{}
+
+bool SchwarzSolver::setup( const vector< vector< IndexType > > & subdomains,
+                           const vector< IndexType > & owner,
+                           ThreadPool* pool )
+{
+    this->pool = pool;
+    size = owner.size();
+    this->subdomains.clear();
+    for( unsigned s = 0; s < subdomains.size(); s++ ) {
+        unique_ptr< Subdomain > subdomain( new Subdomain );
+        subdomain->indexes = subdomains[ s ];
+        subdomain->owned.resize( subdomain->indexes.size() );
+        for( size_t k = 0; k < subdomain->indexes.size(); k++ )
+            subdomain->owned[ k ] = owner[ subdomain->indexes[ k ] ] == (IndexType) s;
+        if( ! subdomain->x.setSize( subdomain->indexes.size() ) || ! subdomain->rhs.setSize( subdomain->indexes.size() ) )
+            return false;
+        this->subdomains.push_back( move( subdomain ) );
+    }
+
+    scaling.resize( size );
+    partial.resize( ( size + block_size - 1 ) / block_size );
+    return basis.setSize( ( restart + 1 ) * size ) && work.setSize( size ) && correction.setSize( size );
+}
+
+template< typename Function >
+void SchwarzSolver::for_blocks( const Function & func )
+{
+    const int blocks = partial.size();
+    parallel_for( ( blocks > 1 ) ? pool : nullptr, blocks,
+        [this, &func] ( int first, int last ) {
+            for( int block = first; block < last; block++ )
+                func( block, block * block_size, min( size, ( block + 1 ) * block_size ) );
+        } );
+}
+
+RealType SchwarzSolver::dot( const RealType* u, const RealType* v )
+{
+    for_blocks( [this, u, v] ( int block, IndexType begin, IndexType end ) {
+        RealType sum = 0.0;
+        for( IndexType i = begin; i < end; i++ )
+            sum += u[ i ] * v[ i ];
+        partial[ block ] = sum;
+    } );
+    RealType sum = 0.0;
+    for( RealType s : partial )
+        sum += s;
+    return sum;
+}
+
+// y = D A x
+void SchwarzSolver::multiply( const SparseMatrix & A, const RealType* x, RealType* y )
+{
+    parallel_for( pool, size,
+        [this, &A, x, y] ( int begin, int end ) {
+            A.multiply( x, y, begin, end );
+            for( int i = begin; i < end; i++ )
+                y[ i ] *= scaling[ i ];
+        } );
+}
+
+// z = M^{-1} r for the scaled matrix D A, the subdomains own disjoint sets
+// of unknowns
+bool SchwarzSolver::precondition( const RealType* r, RealType* z )
+{
+    atomic< bool > status( true );
+    parallel_for( pool, subdomains.size(),
+        [this, r, z, &status] ( int begin, int end ) {
+            for( int s = begin; s < end; s++ ) {
+                Trace::Scope trace( "subdomain solve" );
+                Subdomain & subdomain = *subdomains[ s ];
+                const IndexType n = subdomain.indexes.size();
+                for( IndexType k = 0; k < n; k++ )
+                    subdomain.rhs[ k ] = r[ subdomain.indexes[ k ] ] / scaling[ subdomain.indexes[ k ] ];
+                if( ! subdomain.matrix.linear_solve( subdomain.x, subdomain.rhs ) ) {
+                    status = false;
+                    continue;
+                }
+                for( IndexType k = 0; k < n; k++ ) {
+                    if( subdomain.owned[ k ] )
+                        z[ subdomain.indexes[ k ] ] = subdomain.x[ k ];
+                }
+            }
+        } );
+    return status;
+}
+
+bool SchwarzSolver::solve( const SparseMatrix & A, Vector & x, const Vector & b )
+{
+    if( x.getSize() != size || b.getSize() != size )
+        throw string("passed vectors don't match the subdomains");
+
+    // new values of A: extract the subdomain matrices (numeric factorizations
+    // are computed by the first subdomain solve) and the diagonal scaling
+    parallel_for( pool, subdomains.size(),
+        [this, &A] ( int begin, int end ) {
+            for( int s = begin; s < end; s++ )
+                A.extract( subdomains[ s ]->indexes, subdomains[ s ]->matrix );
+        } );
+    parallel_for( pool, size,
+        [this, &A] ( int begin, int end ) {
+            for( int i = begin; i < end; i++ ) {
+                const RealType diagonal = fabs( A.getElement( i, i ) );
+                scaling[ i ] = ( diagonal > 0.0 ) ? 1.0 / diagonal : 1.0;
+            }
+        } );
+    solves++;
+
+    RealType* V = basis.getData();
+    RealType* w = work.getData();
+
+    // norm of D b
+    for_blocks( [this, &b, w] ( int, IndexType begin, IndexType end ) {
+        for( IndexType i = begin; i < end; i++ )
+            w[ i ] = scaling[ i ] * b[ i ];
+    } );
+    const RealType norm_b = sqrt( dot( w, w ) );
+    if( norm_b == 0.0 ) {
+        x.setAllElements( 0.0 );
+        return true;
+    }
+
+    vector< RealType > H( ( restart + 1 ) * restart );
+    vector< RealType > cs( restart ), sn( restart ), g( restart + 1 ), y( restart );
+
+    unsigned iteration = 0;
+    while( true ) {
+        // r = D ( b - A x )
+        multiply( A, x.getData(), w );
+        for_blocks( [this, &b, V, w] ( int, IndexType begin, IndexType end ) {
+            for( IndexType i = begin; i < end; i++ )
+                V[ i ] = scaling[ i ] * b[ i ] - w[ i ];
+        } );
+        RealType beta = sqrt( dot( V, V ) );
+        if( beta <= tolerance * norm_b )
+            break;
+        if( iteration >= max_iterations ) {
+            cerr << "GMRES did not converge in " << max_iterations << " iterations, relative residual " << beta / norm_b << endl;
+            this->iterations += iteration;
+            return false;
+        }
+
+        for_blocks( [V, beta] ( int, IndexType begin, IndexType end ) {
+            for( IndexType i = begin; i < end; i++ )
+                V[ i ] /= beta;
+        } );
+        fill( g.begin(), g.end(), 0.0 );
+        g[ 0 ] = beta;
+
+        unsigned j = 0;
+        for( ; j < restart && iteration < max_iterations; j++ ) {
+            iteration++;
+            RealType* v_next = V + ( j + 1 ) * size;
+            // v_next = D A M^{-1} v_j
+            if( ! precondition( V + j * size, correction.getData() ) )
+                return false;
+            multiply( A, correction.getData(), v_next );
+
+            // modified Gram-Schmidt
+            for( unsigned i = 0; i <= j; i++ ) {
+                const RealType h = dot( v_next, V + i * size );
+                H[ i * restart + j ] = h;
+                const RealType* v_i = V + i * size;
+                for_blocks( [v_next, v_i, h] ( int, IndexType begin, IndexType end ) {
+                    for( IndexType k = begin; k < end; k++ )
+                        v_next[ k ] -= h * v_i[ k ];
+                } );
+            }
+            const RealType h_next = sqrt( dot( v_next, v_next ) );
+            H[ ( j + 1 ) * restart + j ] = h_next;
+            if( h_next != 0.0 ) {
+                for_blocks( [v_next, h_next] ( int, IndexType begin, IndexType end ) {
+                    for( IndexType k = begin; k < end; k++ )
+                        v_next[ k ] /= h_next;
+                } );
+            }
+
+            // Givens rotations
+            for( unsigned i = 0; i < j; i++ ) {
+                const RealType a = H[ i * restart + j ];
+                const RealType c = H[ ( i + 1 ) * restart + j ];
+                H[ i * restart + j ] = cs[ i ] * a + sn[ i ] * c;
+                H[ ( i + 1 ) * restart + j ] = - sn[ i ] * a + cs[ i ] * c;
+            }
+            const RealType a = H[ j * restart + j ];
+            const RealType r = hypot( a, h_next );
+            cs[ j ] = a / r;
+            sn[ j ] = h_next / r;
+            H[ j * restart + j ] = r;
+            H[ ( j + 1 ) * restart + j ] = 0.0;
+            g[ j + 1 ] = - sn[ j ] * g[ j ];
+            g[ j ] = cs[ j ] * g[ j ];
+
+            if( fabs( g[ j + 1 ] ) <= tolerance * norm_b ) {
+                j++;
+                break;
+            }
+        }
+
+        // x += M^{-1} V y, where H y = g
+        for( int i = j - 1; i >= 0; i-- ) {
+            RealType sum = g[ i ];
+            for( unsigned k = i + 1; k < j; k++ )
+                sum -= H[ i * restart + k ] * y[ k ];
+            y[ i ] = sum / H[ i * restart + i ];
+        }
+        for_blocks( [this, w, V, &y, j] ( int, IndexType begin, IndexType end ) {
+            for( IndexType k = begin; k < end; k++ )
+                w[ k ] = 0.0;
+            for( unsigned i = 0; i < j; i++ ) {
+                for( IndexType k = begin; k < end; k++ )
+                    w[ k ] += y[ i ] * V[ i * size + k ];
+            }
+        } );
+        if( ! precondition( w, correction.getData() ) )
+            return false;
+        RealType* x_data = x.getData();
+        const RealType* dx = correction.getData();
+        for_blocks( [x_data, dx] ( int, IndexType begin, IndexType end ) {
+            for( IndexType k = begin; k < end; k++ )
+                x_data[ k ] += dx[ k ];
+        } );
+    }
+
+    this->iterations += iteration;
+    return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "SparseMatrix.h"
+#include "ThreadPool.h"
+#include "Vector.h"
+
+// Iterative solver for a sparse system: GMRES(restart) right-preconditioned
+// by the restricted additive Schwarz method. The unknowns are covered by
+// overlapping subdomains whose principal submatrices are factorized by
+// UMFPACK; every unknown is owned by exactly one subdomain and the correction
+// of a subdomain is applied only on the unknowns it owns. The subdomain
+// factorizations and solves, the matrix-vector products and the vector
+// operations of GMRES run on the workers of a thread pool.
+// The method does not need a symmetric matrix. The rows are scaled by the
+// inverse diagonal, so that the residual of rows with very different
+// magnitudes (e.g. Dirichlet and interior rows) is measured comparably.
+class SchwarzSolver
+{
+public:
+    SchwarzSolver( RealType tolerance = 1e-10, unsigned max_iterations = 1000, unsigned restart = 30 );
+
+    // subdomains[ s ] is the sorted list of unknowns of subdomain s (overlaps
+    // included), owner[ i ] is the subdomain owning unknown i; the work is
+    // split among the workers of `pool` and the calling thread (serial
+    // without a pool)
+    bool setup( const std::vector< std::vector< IndexType > > & subdomains,
+                const std::vector< IndexType > & owner,
+                ThreadPool* pool );
+
+    // solve A x = b starting from the passed x; the subdomain matrices are
+    // extracted from A, the factorizations are recomputed lazily
+    bool solve( const SparseMatrix & A, Vector & x, const Vector & b );
+
+    unsigned num_subdomains( void ) const { return subdomains.size(); };
+
+    // statistics: number of solves and total number of GMRES iterations
+    unsigned solves = 0;
+    unsigned iterations = 0;
+
+private:
+    struct Subdomain
+    {
+        std::vector< IndexType > indexes;
+        std::vector< char > owned;
+        SparseMatrix matrix;
+        Vector x;
+        Vector rhs;
+    };
+
+    RealType tolerance;     // relative to the norm of the right-hand-side
+    unsigned max_iterations;
+    unsigned restart;
+    ThreadPool* pool = nullptr;
+    IndexType size = 0;
+    std::vector< std::unique_ptr< Subdomain > > subdomains;
+    std::vector< RealType > scaling;    // D = diag( A )^{-1}
+
+    // Krylov basis (restart + 1 vectors of length size) and work vectors
+    Vector basis;
+    Vector work;
+    Vector correction;
+    // partial sums of the reductions per block of unknowns
+    std::vector< RealType > partial;
+
+    bool precondition( const RealType* r, RealType* z );
+    void multiply( const SparseMatrix & A, const RealType* x, RealType* y );
+
+    // func( begin, end ) on the blocks of the unknowns, in parallel only for
+    // more than one block
+    template< typename Function >
+    void for_blocks( const Function & func );
+    // u . v summed per block and then over the blocks in order, so that the
+    // result does not depend on the number of threads
+    RealType dot( const RealType* u, const RealType* v );
+};
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "SnapshotWriter.h"
+
+using namespace std;
+
+SnapshotWriter::SnapshotWriter( unsigned buffers )
+{
+    for( unsigned i = 0; i < max( 1u, buffers ); i++ ) {
+        this->buffers.emplace_back( new Buffer );
+        free.push_back( this->buffers.back().get() );
+    }
+}
+
+SnapshotWriter::~SnapshotWriter( void )
+{
+    finish();
+}
+
+bool SnapshotWriter::write( const string & file_name, const Array & data )
+{
+    return submit( nullptr, 0.0, file_name, { &data } );
+}
+
+bool SnapshotWriter::write( TimeSeriesWriter & series, double time, const vector< const Array* > & data )
+{
+    return submit( &series, time, "", data );
+}
+
+bool SnapshotWriter::submit( TimeSeriesWriter* series, double time, const string & file_name,
+                             const vector< const Array* > & data )
+{
+    Buffer* buffer;
+    {
+        unique_lock< mutex > guard( lock );
+        if( ! worker.joinable() ) {
+            stopping = false;
+            worker = thread( &SnapshotWriter::run, this );
+        }
+        if( free.empty() ) {
+            auto start = chrono::steady_clock::now();
+            buffer_freed.wait( guard, [this] () { return ! free.empty(); } );
+            waits++;
+            wait_seconds += chrono::duration< double >( chrono::steady_clock::now() - start ).count();
+        }
+        buffer = free.front();
+        free.pop_front();
+    }
+
+    // the buffer is owned by this thread until it is queued
+    while( buffer->fields.size() < data.size() )
+        buffer->fields.emplace_back( new Vector );
+    for( size_t f = 0; f < data.size(); f++ ) {
+        Vector & copy = *buffer->fields[ f ];
+        if( copy.getSize() != data[ f ]->getSize() && ! copy.setSize( data[ f ]->getSize() ) ) {
+            cerr << "Failed to allocate a snapshot buffer." << endl;
+            lock_guard< mutex > guard( lock );
+            free.push_back( buffer );
+            return false;
+        }
+        copy_n( data[ f ]->getData(), data[ f ]->getSize(), copy.getData() );
+    }
+    buffer->fields.resize( data.size() );
+    buffer->series = series;
+    buffer->time = time;
+    buffer->file_name = file_name;
+
+    {
+        lock_guard< mutex > guard( lock );
+        queued.push_back( buffer );
+    }
+    buffer_queued.notify_one();
+    return true;
+}
+
+bool SnapshotWriter::finish( void )
+{
+    {
+        lock_guard< mutex > guard( lock );
+        if( ! worker.joinable() )
+            return ! failed;
+        stopping = true;
+    }
+    buffer_queued.notify_one();
+    worker.join();
+    return ! failed;
+}
+
+// the queued snapshots are saved in the order of write() calls, the rest
+// of the queue is saved before stopping
+void SnapshotWriter::run( void )
+{
+    unique_lock< mutex > guard( lock );
+    while( true ) {
+        buffer_queued.wait( guard, [this] () { return stopping || ! queued.empty(); } );
+        if( queued.empty() )
+            return;
+        Buffer* buffer = queued.front();
+        queued.pop_front();
+
+        guard.unlock();
+        bool status;
+        if( buffer->series ) {
+            vector< const Array* > frame;
+            for( const auto & field : buffer->fields )
+                frame.push_back( field.get() );
+            status = buffer->series->append( buffer->time, frame );
+            if( ! status )
+                cerr << "Failed to append the snapshot at time " << buffer->time << " to the time series." << endl;
+        }
+        else {
+            status = buffer->fields[ 0 ]->save( buffer->file_name );
+            if( ! status )
+                cerr << "Failed to save the snapshot " << buffer->file_name << "." << endl;
+        }
+        guard.lock();
+
+        failed |= ! status;
+        written += status;
+        free.push_back( buffer );
+        buffer_freed.notify_one();
+    }
+}
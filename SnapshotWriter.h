@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TimeSeries.h"
+#include "Vector.h"
+
+// Writes snapshots on a background thread, either as text files or as frames
+// of a TimeSeriesWriter. write() copies the arrays into one of the buffers
+// and returns, the computation continues while the copy is formatted and
+// saved. With two buffers, one snapshot can be written while
+// the next one is already queued; when all buffers are taken, write() waits
+// for the oldest one to be saved (back-pressure), so a slow disk delays the
+// computation instead of accumulating copies in memory.
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter( unsigned buffers = 2 );
+    ~SnapshotWriter( void );
+
+    SnapshotWriter( const SnapshotWriter & ) = delete;
+    SnapshotWriter & operator=( const SnapshotWriter & ) = delete;
+
+    // queue a copy of data to be saved by Array::save into file_name; the
+    // writer thread is started by the first call
+    bool write( const std::string & file_name, const Array & data );
+    // queue copies of the fields of one frame to be appended to series, which
+    // must stay open until finish()
+    bool write( TimeSeriesWriter & series, double time, const std::vector< const Array* > & data );
+
+    // wait until all queued snapshots are saved and stop the thread; false
+    // if any of them could not be saved
+    bool finish( void );
+
+    // statistics: saved snapshots and the calls of write() that had to wait
+    // for a free buffer, with the total waiting time
+    unsigned written = 0;
+    unsigned waits = 0;
+    double wait_seconds = 0.0;
+
+private:
+    struct Buffer
+    {
+        std::vector< std::unique_ptr< Vector > > fields;
+        // destination: a frame of series if set, otherwise a text file
+        TimeSeriesWriter* series = nullptr;
+        double time = 0.0;
+        std::string file_name;
+    };
+
+    std::vector< std::unique_ptr< Buffer > > buffers;
+    std::deque< Buffer* > free;
+    std::deque< Buffer* > queued;
+
+    std::mutex lock;
+    std::condition_variable buffer_freed;
+    std::condition_variable buffer_queued;
+    bool stopping = false;
+    bool failed = false;
+    std::thread worker;
+
+    bool submit( TimeSeriesWriter* series, double time, const std::string & file_name,
+                 const std::vector< const Array* > & data );
+    void run( void );
+};
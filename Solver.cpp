@@ -1,9 +1,18 @@
 #include <iostream>
+#include <fstream>
 #include <sstream>
+#include <iomanip>
+#include <limits>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <chrono>
 
 #include <cmath>
 
 #include "Solver.h"
+#include "parallel.h"
 
 using namespace std;
 
@@ -12,14 +21,129 @@ Solver::Solver( string output_prefix,
                 IndexType size_x,
                 IndexType size_y,
                 RealType time_step,
-                RealType time_step_order )
+                RealType time_step_order,
+                const SolverOptions & options )
     : output_prefix( output_prefix ),
       mesh_cols( size_x ),
       mesh_rows( size_y ),
       tau( time_step ),
-      time_step_order( time_step_order )
+      time_step_order( time_step_order ),
+      options( options ),
+      area_width( 10 ),
+      area_height( 10 ),
+      topology( shared_topology( area_width, area_height, size_y, size_x ) ),
+      mesh( topology->mesh ),
+      cell_edges( topology->cell_edges ),
+      cell_boundary( topology->cell_boundary ),
+      cell_colors( topology->cell_colors ),
+      schwarz( options.krylov_tolerance ),
+      snapshots( options.snapshot_buffers )
 {}
 
+// Topologies are cached by the mesh parameters and freed with the last
+// Solver instance using them.
+shared_ptr< const CellTopology > Solver::shared_topology( RealType area_width, RealType area_height,
+                                                         IndexType rows, IndexType cols )
+{
+    typedef tuple< RealType, RealType, IndexType, IndexType > Key;
+    static mutex lock;
+    static map< Key, weak_ptr< const CellTopology > > cache;
+
+    lock_guard< mutex > guard( lock );
+    weak_ptr< const CellTopology > & entry = cache[ Key( area_width, area_height, rows, cols ) ];
+    shared_ptr< const CellTopology > topology = entry.lock();
+    if( topology )
+        return topology;
+
+    shared_ptr< CellTopology > result = make_shared< CellTopology >();
+    RectangularMesh & mesh = result->mesh;
+    mesh.setup( area_width, area_height, rows, cols );
+    const IndexType n = mesh.num_cells();
+    result->cell_edges.resize( 4 * n );
+    result->cell_boundary.resize( n );
+
+    mesh.for_each_cell( [&result, n, &mesh] ( int cell, int row, int col, const int* edges ) {
+        unsigned char mask = 0;
+        for( int i = 0; i < 4; i++ ) {
+            result->cell_edges[ i * n + cell ] = edges[ i ];
+            if( mesh.is_dirichlet_boundary( edges[ i ] ) )
+                mask |= DIRICHLET << i;
+            if( mesh.is_neumann_boundary( edges[ i ] ) )
+                mask |= NEUMANN << i;
+        }
+        result->cell_boundary[ cell ] = mask;
+
+        // checkerboard coloring of cells
+        result->cell_colors[ ( row + col ) % 2 ].push_back( cell );
+    } );
+
+    entry = result;
+    return result;
+}
+
+// progress and summary output, discarded when not verbose
+ostream & Solver::out( void )
+{
+    return options.verbose ? cout : null_output;
+}
+
+// resident set size of the process in bytes (VmRSS), zero if unknown
+static size_t resident_memory( void )
+{
+    ifstream status( "/proc/self/status" );
+    string key;
+    while( status >> key ) {
+        if( key == "VmRSS:" ) {
+            size_t value;
+            status >> value;
+            return value * 1024;
+        }
+        status.ignore( numeric_limits< streamsize >::max(), '\n' );
+    }
+    return 0;
+}
+
+// Bytes of the vectors allocated by allocateVectors() and the Schwarz solver.
+size_t Solver::estimate_array_memory( size_t cells, size_t edges, const SolverOptions & options )
+{
+    // per cell: 8 scalar vectors, 4-component beta, G, cellWeights,
+    // 16 + 4 components of the local systems
+    size_t bytes = cells * ( 8 + 3 * 4 + 20 ) * sizeof( RealType );
+    // per edge: qN, pD, ptrace, rhs
+    bytes += edges * 4 * sizeof( RealType );
+    if( options.integrator == "bdf2" )
+        bytes += cells * sizeof( RealType ) * ( options.adaptive_tolerance > 0.0 ? 2 : 1 );
+    if( options.nonlinear != "none" )
+        bytes += cells * 2 * sizeof( RealType ) + edges * 3 * sizeof( RealType );
+    if( options.steady_tolerance > 0.0 )
+        bytes += ( cells + edges ) * sizeof( RealType );
+    if( options.adaptive_tolerance > 0.0 )
+        bytes += cells * 2 * sizeof( RealType ) + edges * sizeof( RealType );
+    // Krylov basis of the Schwarz solver (31 vectors) and its work vectors
+    if( options.linear_solver == "schwarz" )
+        bytes += edges * 33 * sizeof( RealType );
+    return bytes;
+}
+
+size_t Solver::estimate_memory( IndexType size_x, IndexType size_y, const SolverOptions & options )
+{
+    const size_t cells = (size_t) size_x * size_y;
+    const size_t edges = 2 * cells + size_x + size_y;
+    // vectors and the topology (cell_edges, cell_boundary)
+    size_t bytes = estimate_array_memory( cells, edges, options ) + cells * ( 4 * sizeof( IndexType ) + 1 );
+    // main matrix (at most 7 non-zeros per row) and its LU factors, assuming
+    // fill-in of nested dissection type on the 2D mesh
+    const size_t nnz = 7 * edges;
+    bytes += nnz * ( sizeof( RealType ) + sizeof( IndexType ) ) + ( edges + 1 ) * sizeof( IndexType );
+    const size_t factor_nnz = (size_t) ( 2 * edges * fmax( 1.0, log2( edges ) ) * 4 );
+    bytes += factor_nnz * ( sizeof( RealType ) + sizeof( IndexType ) );
+    // copies of the matrix in the Schwarz subdomains; their factors are
+    // bounded by the global one
+    if( options.linear_solver == "schwarz" )
+        bytes += nnz * ( sizeof( RealType ) + sizeof( IndexType ) );
+    return bytes;
+}
+
 bool Solver::allocateVectors( void )
 {
     bool status = true;
@@ -38,28 +162,75 @@ bool Solver::allocateVectors( void )
 
     // auxiliary variables
     status &=    alpha.setSize( mesh.num_cells() );
-    status &=     beta.setSize( mesh.num_cells(), mesh.num_edges() );
-    status &= beta.reserve( 4 * mesh.num_cells() );     // reserve memory to avoid reallocations
+    status &=     beta.setSize( 4 * mesh.num_cells() );
+    status &=        G.setSize( 4 * mesh.num_cells() );
     status &=   lambda.setSize( mesh.num_cells() );
+    status &= localMatrix.setSize( 16 * mesh.num_cells() );
+    status &=    localRhs.setSize( 4 * mesh.num_cells() );
+    status &= cellWeights.setSize( 4 * mesh.num_cells() );
+    status &=   cellShift.setSize( mesh.num_cells() );
+
+    // state at the beginning of the time step
+    status &= pressure_old.setSize( mesh.num_cells() );
+    if( options.integrator == "bdf2" )
+        status &= pressure_history.setSize( mesh.num_cells() );
+
+    // nonlinear iteration
+    if( options.nonlinear != "none" ) {
+        status &= pressure_iterate.setSize( mesh.num_cells() );
+        status &=   delta_pressure.setSize( mesh.num_cells() );
+        status &=   ptrace_iterate.setSize( mesh.num_edges() );
+        status &=     delta_ptrace.setSize( mesh.num_edges() );
+        status &=     edgeResidual.setSize( mesh.num_edges() );
+    }
+
+    // steady-state detection
+    if( options.steady_tolerance > 0.0 ) {
+        status &= pressure_previous.setSize( mesh.num_cells() );
+        status &=   ptrace_previous.setSize( mesh.num_edges() );
+    }
+
+    // states saved by the adaptive time stepping
+    if( options.adaptive_tolerance > 0.0 ) {
+        status &= pressure_saved.setSize( mesh.num_cells() );
+        status &=  pressure_full.setSize( mesh.num_cells() );
+        status &=   ptrace_saved.setSize( mesh.num_edges() );
+        if( options.integrator == "bdf2" )
+            status &= pressure_history_saved.setSize( mesh.num_cells() );
+    }
 
     return status;
 }
 
 bool Solver::init( void )
 {
-    area_width = 10;
-    area_height = 10;
-    mesh.setup( area_width, area_height, mesh_rows, mesh_cols );
+    if( options.perf_counters ) {
+        if( profiler.enable_counters() ) {
+            out() << "Performance counters:";
+            for( int i = 0; i < profiler.get_counters()->size(); i++ )
+                out() << " " << profiler.get_counters()->name( i );
+            out() << endl;
+        }
+        else
+            cerr << "Performance counters are not available (perf_event_open failed), continuing without them." << endl;
+    }
+    // the workers live as long as the solver, so parallel loops do not pay
+    // for creating threads
+    if( options.threads > 1 && ! pool )
+        pool.reset( new ThreadPool( options.threads - 1, [this] ( unsigned ) { profiler.attach_thread(); } ) );
 
-    if( ! allocateVectors() ) {
-        cerr << "Failed to allocate vectors." << endl;
-        return false;
+    {
+        Profiler::Scope scope( profiler, Profiler::ALLOCATION );
+        if( ! allocateVectors() ) {
+            cerr << "Failed to allocate vectors." << endl;
+            return false;
+        }
     }
 
     // parameters
-    snapshot_period = 1.0;
+    snapshot_period = options.snapshot_period;
     initial_time = 0.0;
-    final_time = 30.0;
+    final_time = options.final_time;
     grav_y = -9.806;
 //    grav_y = 0.0;
     const RealType M = 28.96e-3;
@@ -67,8 +238,8 @@ bool Solver::init( void )
     const RealType T = 300;
     idealGasCoefficient = M / R / T;
     viscosity = 18.6e-6;
-    permeability.setAllElements( 1e-10 );
-    porosity.setAllElements( 0.4 );
+    permeability.setAllElements( options.permeability );
+    porosity.setAllElements( options.porosity );
     F.setAllElements( 0.0 );
 
     // TODO: use sparse vectors
@@ -78,7 +249,7 @@ bool Solver::init( void )
     // gradient on Dirichlet boundary
     IndexType col = 0;
     for( IndexType i = mesh_cols * mesh_rows; i < mesh_cols * (mesh_rows + 1); i++ ) {
-        pD[ i ] = 1e5 + 1e3 / mesh_cols * (col++ + 1);
+        pD[ i ] = options.dirichlet_base + options.dirichlet_gradient / mesh_cols * (col++ + 1);
     }
 
 //    // constant pressure on left border
@@ -98,43 +269,180 @@ bool Solver::init( void )
 
     hxy = mesh.get_hx() / mesh.get_hy();
     hyx = mesh.get_hy() / mesh.get_hx();
+
+    if( options.nonlinear != "none" && options.nonlinear != "picard" && options.nonlinear != "newton" ) {
+        cerr << "Unknown nonlinear iteration '" << options.nonlinear << "'." << endl;
+        return false;
+    }
+    if( options.linear_solver != "umfpack" && options.linear_solver != "schwarz" ) {
+        cerr << "Unknown linear solver '" << options.linear_solver << "'." << endl;
+        return false;
+    }
+    if( options.integrator != "euler" && options.integrator != "bdf2" ) {
+        cerr << "Unknown time integrator '" << options.integrator << "'." << endl;
+        return false;
+    }
+    if( options.snapshot_format != "text" && options.snapshot_format != "binary" ) {
+        cerr << "Unknown snapshot format '" << options.snapshot_format << "'." << endl;
+        return false;
+    }
+
+    init_cell_data();
+
+    kernels = options.isa.empty() ? &cell_kernels() : cell_kernels( options.isa );
+    if( kernels == nullptr ) {
+        cerr << "Instruction set '" << options.isa << "' is not supported." << endl;
+        return false;
+    }
+    out() << "Cell kernels: " << kernels->isa << endl;
+
+    fused = options.fused;
+    if( fused && ( options.integrator != "euler" || options.nonlinear != "none" || options.adaptive_tolerance > 0.0 ) ) {
+        cerr << "The fused pipeline supports only backward Euler with lagged coefficients and fixed time steps, "
+             << "using separate passes." << endl;
+        fused = false;
+    }
+
+    if( options.linear_solver == "schwarz" && ! init_schwarz() )
+        return false;
+
+    return init_main_system();
+}
+
+// Split the cell rows into strips, each strip extended by options.overlap
+// rows of cells on both sides is one subdomain of the Schwarz method. A cell
+// owns its bottom and left edges (and the top/right edges on the boundary
+// of the mesh), an edge is owned by the subdomain of its owner cell.
+bool Solver::init_schwarz( void )
+{
+    const IndexType strips = min( (IndexType) ( options.subdomains > 0 ? options.subdomains : options.threads ), mesh_rows );
+    const IndexType overlap = options.overlap;
+    auto strip_of_row = [this, strips] ( int row ) { return (IndexType) ( (long) row * strips / mesh_rows ); };
+
+    vector< IndexType > owner( mesh.num_edges() );
+    vector< vector< IndexType > > subdomains( strips );
+    mesh.for_each_cell( [&] ( int, int row, int col, const int* edges ) {
+        const IndexType strip = strip_of_row( row );
+        owner[ edges[ 0 ] ] = owner[ edges[ 2 ] ] = strip;
+        if( row == mesh_rows - 1 )
+            owner[ edges[ 1 ] ] = strip;
+        if( col == mesh_cols - 1 )
+            owner[ edges[ 3 ] ] = strip;
+
+        // the cell belongs to every strip within the overlap
+        for( IndexType s = strip_of_row( max( row - overlap, 0 ) ); s <= strip_of_row( min( row + overlap, mesh_rows - 1 ) ); s++ )
+            subdomains[ s ].insert( subdomains[ s ].end(), edges, edges + 4 );
+    } );
+    for( auto & subdomain : subdomains ) {
+        sort( subdomain.begin(), subdomain.end() );
+        subdomain.erase( unique( subdomain.begin(), subdomain.end() ), subdomain.end() );
+    }
+
+    if( ! schwarz.setup( subdomains, owner, pool.get() ) ) {
+        cerr << "Failed to allocate the Schwarz solver." << endl;
+        return false;
+    }
+    out() << "Schwarz solver: " << strips << " subdomains, overlap " << overlap << endl;
     return true;
 }
 
-RealType Solver::G_KE( IndexType cell, IndexType edge )
+// Solve mainMatrix x = rhs, x is also the initial guess of the iterative solver.
+bool Solver::solve_main_system( Vector & x )
 {
-    // left or right
-    if( mesh.is_vertical_edge( edge ) )
-        return 0.0;
+    if( options.linear_solver == "schwarz" ) {
+        Profiler::Scope scope( profiler, Profiler::SOLVE );
+        return schwarz.solve( mainMatrix, x, rhs );
+    }
+    {
+        Profiler::Scope scope( profiler, Profiler::SYMBOLIC );
+        if( ! mainMatrix.symbolic_factorization() )
+            return false;
+    }
+    {
+        Profiler::Scope scope( profiler, Profiler::NUMERIC );
+        if( ! mainMatrix.numeric_factorization() )
+            return false;
+    }
+    Profiler::Scope scope( profiler, Profiler::SOLVE );
+    return mainMatrix.solve_factorized( x, rhs );
+}
 
-    RealType value = 0.5 * idealGasCoefficient * grav_y * mesh.get_hy();
+// Set up the gravity terms G_KE.
+void Solver::init_cell_data( void )
+{
+    const IndexType n = mesh.num_cells();
 
-    // bottom
-    if( mesh.get_edge_order( cell, edge ) == 1 )
-        return value;
+    // G_KE is non-zero only on horizontal edges:
+    // positive on the top edge (order 1), negative on the bottom edge (order 0)
+    const RealType g = 0.5 * idealGasCoefficient * grav_y * mesh.get_hy();
+    const RealType G_order[ 4 ] = { -g, g, 0.0, 0.0 };
 
-    // top
-    return -value;
+    for( IndexType cell = 0; cell < n; cell++ ) {
+        for( int i = 0; i < 4; i++ )
+            G[ i * n + cell ] = G_order[ i ];
+    }
 }
 
-bool Solver::update_auxiliary_vectors( const RealType & time, const RealType & tau )
+// Set up the sparsity pattern of the main matrix. The pattern does not change
+// between time steps, update_main_system only accumulates values into it.
+bool Solver::init_main_system( void )
 {
-    // depends on tau
-    for( IndexType cell = 0; cell < mesh.num_cells(); cell++ ) {
-        lambda[ cell ] = porosity[ cell ] * idealGasCoefficient * mesh.cell_volume( cell ) / tau;
+    {
+        Profiler::Scope scope( profiler, Profiler::ALLOCATION );
+        bool status = mainMatrix.setSize( mesh.num_edges(), mesh.num_edges() );
+        if( ! status ) {
+            cerr << "Failed to set size of the main matrix." << endl;
+            return false;
+        }
+
+        // reserve space to avoid reallocation
+        status = mainMatrix.reserve( 7 * ( mesh.num_edges() - mesh.num_neumann_edges() - mesh.num_dirichlet_edges() ) + 4 * mesh.num_neumann_edges() + mesh.num_dirichlet_edges() );
+        if( ! status ) {
+            cerr << "Failed to reserve space for non-zero elements in the main matrix." << endl;
+            return false;
+        }
+    }
+
+    // rows in increasing order so that elements are mostly appended
+    for( IndexType indexRow = 0; indexRow < mesh.num_edges(); indexRow++ ) {
+        if( mesh.is_dirichlet_boundary( indexRow ) ) {
+            mainMatrix.setElement( indexRow, indexRow, 1.0 );
+            continue;
+        }
+        for( IndexType i = 0; i < 2; i++ ) {
+            IndexType cell = mesh.cell_for_edge( indexRow, i );
+            if( cell < 0 )
+                continue;
+            for( IndexType j = 0; j < 4; j++ ) {
+                IndexType indexColumn = mesh.edge_for_cell( cell, j );
+                if( ! mesh.is_dirichlet_boundary( indexColumn ) )
+                    mainMatrix.setElement( indexRow, indexColumn, 1.0 );
+            }
+        }
     }
+    mainMatrix.resetValues();
+
+    return true;
+}
+
+bool Solver::update_auxiliary_vectors( const RealType & time, const RealType & tau )
+{
+    Profiler::Scope scope( profiler, Profiler::AUXILIARY );
+    // depends on tau (cells of the rectangular mesh have the same volume)
+    kernels->scale( mesh.num_cells(), idealGasCoefficient * mesh.cell_volume( 0 ) / tau, porosity.getData(), lambda.getData() );
 
     // constant in time
     if( time > initial_time )
         return true;
 
-    for( IndexType cell = 0; cell < mesh.num_cells(); cell++ ) {
+    const IndexType n = mesh.num_cells();
+    for( IndexType cell = 0; cell < n; cell++ ) {
         alpha[ cell ] = 0.0;
         for( int i = 0; i < 4; i++ ) {
-            IndexType edge = mesh.edge_for_cell( cell, i );
+            // local order: bottom, top (horizontal), left, right (vertical)
             RealType value = 2 * idealGasCoefficient * permeability[ cell ] / viscosity
-                    * (( mesh.is_horizontal_edge(edge) ) ? hxy : hyx);
-            beta.setElement( cell, edge, value );
+                    * (( i < 2 ) ? hxy : hyx);
+            beta[ i * n + cell ] = value;
             alpha[ cell ] += value;
         }
     }
@@ -142,69 +450,317 @@ bool Solver::update_auxiliary_vectors( const RealType & time, const RealType & t
     return true;
 }
 
-bool Solver::update_main_system( const RealType & time )
+// Compute the local 4x4 block and the local right-hand-side of one cell,
+// together with the coefficients reused by update_pressure:
+//     pressure = sum_i cellWeights_i * ptrace_i + cellShift
+// The block B (row-major) and the rhs r are written to the passed arrays.
+void Solver::update_local_system( IndexType cell, RealType* B, RealType* r )
 {
-    for( IndexType indexRow = 0; indexRow < mesh.num_edges(); indexRow++ ) {
-        rhs[ indexRow ] = 0.0;
-
-        // inner edge or Neumann boundary
-        if( ! mesh.is_dirichlet_boundary( indexRow ) ) {
-            for( IndexType i = 0; i < 2; i++ ) {
-                IndexType cell = mesh.cell_for_edge( indexRow, i );
-                // on Neumann boundary only one term/cell contributes
-                if( cell < 0 )
-                    continue;
-
-                for( IndexType j = 0; j < 4; j++ ) {
-                    IndexType indexColumn = mesh.edge_for_cell( cell, j );
-
-                    RealType B_KEF = - beta.getElement( cell, indexRow ) * pressure[ cell ] * beta.getElement( cell, indexColumn ) * pressure[ cell ] / ( lambda[ cell ] + alpha[ cell ] * pressure[ cell ] );
-                    if( indexRow == indexColumn )
-                        B_KEF += beta.getElement( cell, indexRow ) * pressure[ cell ];
-
-                    if( ! mesh.is_dirichlet_boundary( indexColumn ) ) {
-                        // set main matrix element
-                        RealType value = mainMatrix.getElement( indexRow, indexColumn );
-                        mainMatrix.setElement( indexRow, indexColumn, value + B_KEF );
-                    }
-                    else {
-                        rhs[ indexRow ] -= B_KEF * pD[ indexColumn ];
-                    }
-                    // right hand side
-                    rhs[ indexRow ] += B_KEF * G_KE( cell, indexColumn ) * pressure[ cell ];
-                }
+    const IndexType n = mesh.num_cells();
+    const IndexType* edges = cell_edges.data();
+    const RealType* beta_data = beta.getData();
+    const RealType* G_data = G.getData();
+    RealType* w = cellWeights.getData();
+    const unsigned char mask = cell_boundary[ cell ];
 
-                // right-hand-side
-                rhs[ indexRow ] += beta.getElement( cell, indexRow ) * pressure[ cell ] / ( lambda[ cell ] + alpha[ cell ] * pressure[ cell ] ) * ( F[ cell ] + lambda[ cell ] * pressure[ cell ] );
-            }
+    // pressure is the current approximation of the new state (lagged
+    // coefficients), pressure_old the history term of the time derivative
+    const RealType p = pressure.getElement( cell );
+    const RealType denominator = lambda.getElement( cell ) + alpha.getElement( cell ) * p;
+    const RealType source = F.getElement( cell ) + lambda.getElement( cell ) * pressure_old.getElement( cell );
+
+    RealType beta_p[ 4 ];
+    RealType G_p[ 4 ];
+    RealType shift = source;
+    for( int i = 0; i < 4; i++ ) {
+        beta_p[ i ] = beta_data[ i * n + cell ] * p;
+        G_p[ i ] = G_data[ i * n + cell ] * p;
+        w[ i * n + cell ] = beta_p[ i ] / denominator;
+        shift -= beta_p[ i ] * G_p[ i ];
+    }
+    cellShift.setElement( cell, shift / denominator );
+
+    for( int i = 0; i < 4; i++ ) {
+        RealType r_i = w[ i * n + cell ] * source;
+        for( int j = 0; j < 4; j++ ) {
+            RealType B_KEF = - beta_p[ i ] * w[ j * n + cell ];
+            if( i == j )
+                B_KEF += beta_p[ i ];
+            B[ 4 * i + j ] = B_KEF;
+
+            // Dirichlet columns are moved to the right-hand-side
+            if( mask & ( DIRICHLET << j ) )
+                r_i -= B_KEF * pD.getElement( edges[ j * n + cell ] );
+            r_i += B_KEF * G_p[ j ];
+        }
+        r[ i ] = r_i;
+    }
+}
+
+// Newton linearization of the fully implicit cell terms. The unknowns are
+// the corrections of ptrace; the cell correction is eliminated locally:
+//     delta_pressure = sum_i cellWeights_i * delta_ptrace_i + cellShift
+// Cell residual:      R_K = lambda (p - p_old) - F + sum_i beta_i p (p - ptrace_i + G_i p)
+// Flux through edge:  q_i = beta_i p (ptrace_i - G_i p - p)
+// Dirichlet traces are already set, so their corrections are zero.
+void Solver::update_newton_local_system( IndexType cell, RealType* B, RealType* r )
+{
+    const IndexType n = mesh.num_cells();
+    const IndexType* edges = cell_edges.data();
+    const RealType* beta_data = beta.getData();
+    const RealType* G_data = G.getData();
+    const RealType* trace = ptrace.getData();
+    RealType* w = cellWeights.getData();
+
+    const RealType p = pressure.getElement( cell );
+    const RealType l = lambda.getElement( cell );
+
+    RealType R = l * ( p - pressure_old.getElement( cell ) ) - F.getElement( cell );
+    RealType d = l;     // dR/dp
+    RealType beta_p[ 4 ];
+    RealType flux[ 4 ];
+    RealType a[ 4 ];    // dq_i/dp
+    for( int i = 0; i < 4; i++ ) {
+        const RealType b = beta_data[ i * n + cell ];
+        const RealType G_p = G_data[ i * n + cell ] * p;
+        const RealType t = trace[ edges[ i * n + cell ] ];
+        beta_p[ i ] = b * p;
+        flux[ i ] = beta_p[ i ] * ( t - G_p - p );
+        a[ i ] = b * ( t - 2 * G_p - 2 * p );
+        R -= flux[ i ];
+        d += b * ( 2 * p - t + 2 * G_p );
+    }
+
+    for( int i = 0; i < 4; i++ )
+        w[ i * n + cell ] = beta_p[ i ] / d;
+    const RealType shift = - R / d;
+    cellShift.setElement( cell, shift );
+
+    for( int i = 0; i < 4; i++ ) {
+        for( int j = 0; j < 4; j++ ) {
+            RealType J = a[ i ] * w[ j * n + cell ];
+            if( i == j )
+                J += beta_p[ i ];
+            B[ 4 * i + j ] = J;
         }
+        r[ i ] = - flux[ i ] - a[ i ] * shift;
+    }
+}
+
+// Add the local system of one cell to the rows of its edges. Boundary edges
+// belong to a single cell, so their rows are set up here as well. For a
+// Newton correction the Dirichlet rows are homogeneous.
+void Solver::scatter_local_system( IndexType cell, const RealType* B, const RealType* r, bool correction )
+{
+    const IndexType n = mesh.num_cells();
+    const IndexType* edges = cell_edges.data();
+    const unsigned char mask = cell_boundary[ cell ];
+
+    for( int i = 0; i < 4; i++ ) {
+        const IndexType indexRow = edges[ i * n + cell ];
         // Dirichlet boundary
-        else {
-            mainMatrix.setElement( indexRow, indexRow, 1.0 );
-            rhs[ indexRow ] = pD[ indexRow ];
+        if( mask & ( DIRICHLET << i ) ) {
+            mainMatrix.addElement( indexRow, indexRow, 1.0 );
+            rhs.setElement( indexRow, correction ? 0.0 : pD.getElement( indexRow ) );
+            continue;
         }
-        // Neumann boundary
-        if( mesh.is_neumann_boundary( indexRow ) ) {
-            rhs[ indexRow ] += qN[ indexRow ];
+
+        for( int j = 0; j < 4; j++ ) {
+            if( ! ( mask & ( DIRICHLET << j ) ) )
+                mainMatrix.addElement( indexRow, edges[ j * n + cell ], B[ 4 * i + j ] );
         }
+        RealType r_i = rhs.getElement( indexRow ) + r[ i ];
+        // Neumann boundary
+        if( mask & ( NEUMANN << i ) )
+            r_i += qN.getElement( indexRow );
+        rhs.setElement( indexRow, r_i );
+    }
+}
+
+bool Solver::update_main_system( const RealType & time, bool newton )
+{
+    Profiler::Scope scope( profiler, Profiler::ASSEMBLY );
+    // local systems are independent, any partitioning of the cells works
+    parallel_for( pool.get(), mesh.num_cells(),
+        [this, newton] ( int begin, int end ) {
+            Trace::Scope trace( "local systems" );
+            for( IndexType cell = begin; cell < end; cell++ ) {
+                RealType* B = localMatrix.getData() + 16 * cell;
+                RealType* r = localRhs.getData() + 4 * cell;
+                if( newton )
+                    update_newton_local_system( cell, B, r );
+                else
+                    update_local_system( cell, B, r );
+            }
+        } );
+
+    // resetValues() keeps the pattern set up in init_main_system()
+    mainMatrix.resetValues();
+    rhs.setAllElements( 0.0 );
+
+    // cells of one color touch disjoint rows, so they can be processed concurrently
+    for( int color = 0; color < 2; color++ ) {
+        const std::vector< IndexType > & cells = cell_colors[ color ];
+        parallel_for( pool.get(), cells.size(),
+            [this, &cells, newton] ( int begin, int end ) {
+                Trace::Scope trace( "scatter" );
+                for( int i = begin; i < end; i++ ) {
+                    const IndexType cell = cells[ i ];
+                    scatter_local_system( cell, localMatrix.getData() + 16 * cell, localRhs.getData() + 4 * cell, newton );
+                }
+            } );
     }
     return true;
 }
 
+// result = cellShift + sum_i cellWeights_i * trace_i with the coefficients
+// cached by the last update_main_system
+void Solver::reconstruct_cells( const Vector & trace, Vector & result )
+{
+    const IndexType n = mesh.num_cells();
+    parallel_for( pool.get(), n,
+        [this, n, &trace, &result] ( int begin, int end ) {
+            kernels->update_pressure( end - begin, n,
+                                      cell_edges.data() + begin,
+                                      cellWeights.getData() + begin,
+                                      cellShift.getData() + begin,
+                                      trace.getData(),
+                                      result.getData() + begin );
+        } );
+}
+
+// Uses the coefficients cached by update_local_system in the current step.
 bool Solver::update_pressure( void )
 {
-    for( IndexType cell = 0; cell < mesh.num_cells(); cell++ ) {
-        RealType p = 0.0;
-        for( IndexType i = 0; i < mesh.edges_per_cell(); i++ ) {
-            IndexType edge = mesh.edge_for_cell( cell, i );
-            p += beta.getElement( cell, edge ) * ( ptrace[ edge ] - G_KE( cell, edge ) * pressure[ cell ] );
+    Profiler::Scope scope( profiler, Profiler::PRESSURE );
+    reconstruct_cells( ptrace, pressure );
+    return true;
+}
+
+// Fused pipeline: a single blocked sweep over the rows of cells which
+// reconstructs pressure from the new ptrace, saves it as the state for the
+// next step, recomputes lambda for the step length `tau` and assembles the
+// next main system. Each row of cells is contiguous in all per-cell arrays
+// and the local systems stay in registers, so the per-cell data are read
+// from memory once per step instead of once per pass. Rows of the same
+// parity share no edge and are processed concurrently.
+void Solver::fused_sweep( const RealType & tau )
+{
+    Profiler::Scope scope( profiler, Profiler::FUSED );
+    const IndexType n = mesh.num_cells();
+    const RealType factor = idealGasCoefficient * mesh.cell_volume( 0 ) / tau;
+
+    mainMatrix.resetValues();
+    rhs.setAllElements( 0.0 );
+
+    for( int parity = 0; parity < 2; parity++ ) {
+        parallel_for( pool.get(), ( mesh_rows + 1 - parity ) / 2,
+            [this, n, factor, parity] ( int begin, int end ) {
+                for( int k = begin; k < end; k++ ) {
+                    const IndexType first = ( 2 * k + parity ) * mesh_cols;
+                    kernels->update_pressure( mesh_cols, n,
+                                              cell_edges.data() + first,
+                                              cellWeights.getData() + first,
+                                              cellShift.getData() + first,
+                                              ptrace.getData(),
+                                              pressure.getData() + first );
+                    copy_n( pressure.getData() + first, mesh_cols, pressure_old.getData() + first );
+                    kernels->scale( mesh_cols, factor, porosity.getData() + first, lambda.getData() + first );
+                    for( IndexType cell = first; cell < first + mesh_cols; cell++ ) {
+                        RealType B[ 16 ];
+                        RealType r[ 4 ];
+                        update_local_system( cell, B, r );
+                        scatter_local_system( cell, B, r, false );
+                    }
+                }
+            } );
+    }
+}
+
+// Euclidean norm of the residual of the fully implicit scheme at the current
+// pressure and ptrace (see update_newton_local_system for the terms).
+RealType Solver::nonlinear_residual( void )
+{
+    const IndexType n = mesh.num_cells();
+    const IndexType* edges = cell_edges.data();
+    const RealType* beta_data = beta.getData();
+    const RealType* G_data = G.getData();
+    const RealType* trace = ptrace.getData();
+    RealType* edge_residual = edgeResidual.getData();
+
+    edgeResidual.setAllElements( 0.0 );
+    RealType sum = 0.0;
+    for( IndexType cell = 0; cell < n; cell++ ) {
+        const RealType p = pressure[ cell ];
+        const unsigned char mask = cell_boundary[ cell ];
+        RealType R = lambda[ cell ] * ( p - pressure_old[ cell ] ) - F[ cell ];
+        for( int i = 0; i < 4; i++ ) {
+            const IndexType edge = edges[ i * n + cell ];
+            const RealType flux = beta_data[ i * n + cell ] * p * ( trace[ edge ] - G_data[ i * n + cell ] * p - p );
+            R -= flux;
+            if( mask & ( DIRICHLET << i ) )
+                edge_residual[ edge ] = trace[ edge ] - pD[ edge ];
+            else if( mask & ( NEUMANN << i ) )
+                edge_residual[ edge ] += flux - qN[ edge ];
+            else
+                edge_residual[ edge ] += flux;
         }
-        p *= pressure[ cell ];
-        p += F[ cell ] + lambda[ cell ] * pressure[ cell ];
-        p /= lambda[ cell ] + alpha[ cell ] * pressure[ cell ];
-        pressure[ cell ] = p;
+        sum += R * R;
     }
-    return true;
+    for( IndexType edge = 0; edge < mesh.num_edges(); edge++ )
+        sum += edge_residual[ edge ] * edge_residual[ edge ];
+    return sqrt( sum );
+}
+
+// Backtracking line search along (delta_pressure, delta_ptrace) from the
+// state saved in pressure_iterate and ptrace_iterate. Leaves the accepted
+// state in pressure and ptrace and returns its step length. Without
+// backtracking the full step is taken.
+RealType Solver::line_search( const RealType & residual, RealType & new_residual, bool backtrack )
+{
+    const IndexType n = mesh.num_cells();
+    const IndexType m = mesh.num_edges();
+    RealType theta = 1.0;
+    for( unsigned attempt = 0; ; attempt++ ) {
+        for( IndexType cell = 0; cell < n; cell++ )
+            pressure[ cell ] = pressure_iterate[ cell ] + theta * delta_pressure[ cell ];
+        for( IndexType edge = 0; edge < m; edge++ )
+            ptrace[ edge ] = ptrace_iterate[ edge ] + theta * delta_ptrace[ edge ];
+
+        new_residual = nonlinear_residual();
+        // sufficient decrease (Armijo condition)
+        if( ! backtrack || new_residual <= ( 1.0 - 1e-4 * theta ) * residual || attempt == 10 )
+            return theta;
+        theta *= 0.5;
+        line_search_reductions++;
+    }
+}
+
+bool Solver::open_series( void )
+{
+    const TimeSeries::Type type = options.snapshot_float32 ? TimeSeries::FLOAT32 : TimeSeries::FLOAT64;
+    if( ! series.add_field( "pressure", TimeSeries::CELLS, mesh.num_cells(), type ) ||
+        ! series.add_field( "ptrace", TimeSeries::EDGES, mesh.num_edges(), type ) )
+        return false;
+    return series.open( output_prefix + ".snap", area_width, area_height, mesh.get_rows(), mesh.get_cols() );
+}
+
+void Solver::save_snapshot( IndexType number, const RealType & time )
+{
+    Profiler::Scope scope( profiler, Profiler::SNAPSHOT );
+    if( series.is_open() ) {
+        const vector< const Array* > frame = { &pressure, &ptrace };
+        if( options.snapshot_buffers > 0 )
+            snapshots.write( series, time, frame );
+        else if( ! series.append( time, frame ) )
+            cerr << "Failed to append the snapshot at time " << time << " to the time series." << endl;
+        return;
+    }
+    const string file_name = output_prefix + "-" + pad_number( number ) + ".dat";
+    if( options.snapshot_buffers > 0 )
+        snapshots.write( file_name, pressure );
+    else if( ! pressure.save( file_name ) )
+        cerr << "Failed to save the snapshot " << file_name << "." << endl;
 }
 
 template< typename T >
@@ -218,49 +774,440 @@ string Solver::pad_number( const T & number )
     return ss.str();
 }
 
-bool Solver::solve( const RealType & time_start, const RealType & time_stop )
+// Advance pressure and ptrace from `time` by one step of length `tau`.
+bool Solver::step( const RealType & time, const RealType & tau )
+{
+    const IndexType n = mesh.num_cells();
+
+    // the state, lambda and the main system were prepared by the last fused sweep
+    if( fused && tau == fused_tau )
+        return linear_step( time, tau );
+
+    // Variable-step BDF2 with the step ratio w = tau / history_tau:
+    //     a0 p^{n+1} - (1+w) p^n + w^2/(1+w) p^{n-1} = tau * (...),  a0 = (1+2w)/(1+w)
+    // which is backward Euler with the step tau / a0 from the state
+    //     pressure_old = ( (1+w) p^n - w^2/(1+w) p^{n-1} ) / a0.
+    // The method is zero-stable only for w < 1 + sqrt(2), so after a large
+    // jump of the step length (and on the first step) it restarts with
+    // backward Euler.
+    RealType a0 = 1.0;
+    const RealType w = ( history_tau > 0.0 ) ? tau / history_tau : 0.0;
+    if( options.integrator == "bdf2" && w > 0.0 && w < 1.0 + sqrt( 2.0 ) ) {
+        a0 = ( 1 + 2 * w ) / ( 1 + w );
+        const RealType c1 = ( 1 + w ) / a0;
+        const RealType c2 = w * w / ( 1 + w ) / a0;
+        for( IndexType cell = 0; cell < n; cell++ ) {
+            const RealType p = pressure[ cell ];
+            const RealType p_prev = pressure_history[ cell ];
+            pressure_old[ cell ] = c1 * p - c2 * p_prev;
+            pressure_history[ cell ] = p;
+            // second order extrapolation for the lagged coefficients and
+            // the initial guess of the nonlinear iteration
+            pressure[ cell ] = ( 1 + w ) * p - w * p_prev;
+        }
+    }
+    else {
+        copy_n( pressure.getData(), n, pressure_old.getData() );
+        if( options.integrator == "bdf2" ) {
+            copy_n( pressure.getData(), n, pressure_history.getData() );
+            if( history_tau > 0.0 )
+                euler_restarts++;
+        }
+    }
+    history_tau = tau;
+
+    // update auxiliary vectors
+    update_auxiliary_vectors( time, tau / a0 );
+
+    if( options.nonlinear == "none" )
+        return linear_step( time, tau );
+    return nonlinear_step( time, tau );
+}
+
+// One linear solve with coefficients lagged from the current pressure.
+bool Solver::linear_step( const RealType & time, const RealType & tau )
 {
-    RealType time = time_start;
     bool status = true;
+    if( ! fused || tau != fused_tau )
+        status = update_main_system( time + tau );
+    if( ! status ) {
+        cerr << "Failed to update the main system." << endl;
+        return false;
+    }
 
-    while( time < time_stop ) {
-        RealType current_tau = fmin( tau, time_stop - time );
+    status = solve_main_system( ptrace );
+    if( ! status ) {
+        cerr << "Failed to solve the main system." << endl;
+        return false;
+    }
 
-        cout << "Time: " << time << endl;
+    if( fused ) {
+        // prepare the next step, assuming the regular step length
+        fused_sweep( Solver::tau );
+        fused_tau = Solver::tau;
+    }
+    else
+        update_pressure();
+    return true;
+}
 
-        // update auxiliary vectors
-        update_auxiliary_vectors( time, current_tau );
+// Picard or Newton iteration of the fully implicit scheme, both globalized
+// by a line search on the norm of the nonlinear residual.
+bool Solver::nonlinear_step( const RealType & time, const RealType & tau )
+{
+    const IndexType n = mesh.num_cells();
+    const IndexType m = mesh.num_edges();
+    const bool newton = options.nonlinear == "newton";
 
-        // setSize() clears the matrix
-        status = mainMatrix.setSize( mesh.num_edges(), mesh.num_edges() );
-        if( ! status ) {
-            cerr << "Failed to set size of the main matrix." << endl;
-            return false;
+    // Newton corrections keep the Dirichlet traces
+    for( IndexType cell = 0; cell < n; cell++ ) {
+        for( int i = 0; i < 4; i++ ) {
+            if( cell_boundary[ cell ] & ( DIRICHLET << i ) ) {
+                const IndexType edge = cell_edges[ i * n + cell ];
+                ptrace[ edge ] = pD[ edge ];
+            }
         }
+    }
 
-        // reserve space to avoid reallocation
-        status = mainMatrix.reserve( 7 * ( mesh.num_edges() - mesh.num_neumann_edges() - mesh.num_dirichlet_edges() ) + 4 * mesh.num_neumann_edges() + mesh.num_dirichlet_edges() );
-        if( ! status ) {
-            cerr << "Failed to reserve space for non-zero elements in the main matrix." << endl;
-            return false;
+    RealType residual = nonlinear_residual();
+    unsigned iteration = 0;
+    bool converged = false;
+    bool finite = true;
+    while( ! converged && iteration < options.nonlinear_max_iterations ) {
+        iteration++;
+        copy_n( pressure.getData(), n, pressure_iterate.getData() );
+        copy_n( ptrace.getData(), m, ptrace_iterate.getData() );
+
+        if( newton ) {
+            if( ! update_main_system( time + tau, true ) ) {
+                cerr << "Failed to update the Newton system." << endl;
+                return false;
+            }
+            delta_ptrace.setAllElements( 0.0 );
+            if( ! solve_main_system( delta_ptrace ) ) {
+                cerr << "Failed to solve the Newton system." << endl;
+                return false;
+            }
+            reconstruct_cells( delta_ptrace, delta_pressure );
+        }
+        else {
+            if( ! linear_step( time, tau ) )
+                return false;
+            for( IndexType cell = 0; cell < n; cell++ )
+                delta_pressure[ cell ] = pressure[ cell ] - pressure_iterate[ cell ];
+            for( IndexType edge = 0; edge < m; edge++ )
+                delta_ptrace[ edge ] = ptrace[ edge ] - ptrace_iterate[ edge ];
         }
 
-        status = update_main_system( time + current_tau );
-        if( ! status ) {
-            cerr << "Failed to update the main system." << endl;
+        // fmax drops NaN, so the divergence is detected separately
+        RealType change = 0.0;
+        for( IndexType cell = 0; cell < n; cell++ ) {
+            finite &= isfinite( delta_pressure[ cell ] );
+            change = fmax( change, fabs( delta_pressure[ cell ] ) / fabs( pressure_iterate[ cell ] + delta_pressure[ cell ] ) );
+        }
+        if( ! finite )
+            break;
+        converged = change <= options.nonlinear_tolerance;
+
+        // near the solution the residual is dominated by rounding errors,
+        // so a converged step is taken without the line search
+        RealType new_residual = 0.0;
+        line_search( residual, new_residual, ! converged );
+        residual = new_residual;
+    }
+
+    nonlinear_iterations += iteration;
+    max_nonlinear_iterations = max( max_nonlinear_iterations, iteration );
+    nonlinear_steps++;
+    if( ! converged )
+        nonlinear_failures++;
+    nonlinear_last_residual = residual;
+
+    // the adaptive stepper rejects the non-finite state and retries with a
+    // shorter step, otherwise the time loop cannot continue
+    if( ! finite && options.adaptive_tolerance <= 0.0 ) {
+        cerr << "The nonlinear iteration diverged at time " << time + tau << "." << endl;
+        return false;
+    }
+    return true;
+}
+
+// Adaptive step by step doubling: one step of length tau is compared with two
+// steps of length tau/2. The step is repeated with a shorter tau until the
+// relative difference of the pressures is within options.adaptive_tolerance.
+// On success the more accurate two-step solution is kept, `tau` is set to the
+// length of the accepted step and `next_tau` to the proposed next one.
+bool Solver::adaptive_step( const RealType & time, RealType & tau, RealType & next_tau )
+{
+    const IndexType n = mesh.num_cells();
+    const bool bdf2 = options.integrator == "bdf2";
+    copy_n( pressure.getData(), n, pressure_saved.getData() );
+    copy_n( ptrace.getData(), mesh.num_edges(), ptrace_saved.getData() );
+    if( bdf2 )
+        copy_n( pressure_history.getData(), n, pressure_history_saved.getData() );
+    history_tau_saved = history_tau;
+
+    // a rejection shrinks tau by at least 10 %, or 5 times for a non-finite solution
+    const unsigned max_rejections = 100;
+    unsigned rejections = 0;
+    while( true ) {
+        // one full step
+        if( ! step( time, tau ) )
+            return false;
+        copy_n( pressure.getData(), n, pressure_full.getData() );
+
+        // two half steps from the same state
+        copy_n( pressure_saved.getData(), n, pressure.getData() );
+        copy_n( ptrace_saved.getData(), mesh.num_edges(), ptrace.getData() );
+        if( bdf2 )
+            copy_n( pressure_history_saved.getData(), n, pressure_history.getData() );
+        history_tau = history_tau_saved;
+        if( ! step( time, 0.5 * tau ) || ! step( time + 0.5 * tau, 0.5 * tau ) )
             return false;
+
+        // a non-finite solution (dropped by fmax) is rejected like a large error
+        RealType error = 0.0;
+        bool finite = true;
+        for( IndexType cell = 0; cell < n; cell++ ) {
+            finite &= isfinite( pressure[ cell ] ) && isfinite( pressure_full[ cell ] );
+            error = fmax( error, fabs( pressure[ cell ] - pressure_full[ cell ] ) / fabs( pressure[ cell ] ) );
         }
+        if( ! finite )
+            error = HUGE_VAL;
+        error /= options.adaptive_tolerance;
 
-        status = mainMatrix.linear_solve( ptrace, rhs );
-        if( ! status ) {
-            cerr << "Failed to solve the main system." << endl;
+        // local error is O(tau^2) for backward Euler and O(tau^3) for BDF2;
+        // the growth of BDF2 steps is limited so that the next full step
+        // (ratio to the last half step) stays below 1 + sqrt(2)
+        const RealType order = bdf2 ? 3.0 : 2.0;
+        const RealType max_factor = bdf2 ? 1.2 : 5.0;
+        const RealType factor = ( error > 0.0 ) ? 0.9 * pow( error, -1.0 / order ) : max_factor;
+        RealType proposed = tau * fmin( max_factor, fmax( 0.2, factor ) );
+        if( options.tau_max > 0.0 )
+            proposed = fmin( proposed, options.tau_max );
+        proposed = fmax( proposed, options.tau_min );
+
+        // accept, or give up shrinking at the lower bound
+        if( error <= 1.0 || ( finite && tau <= options.tau_min ) ) {
+            accepted_steps++;
+            next_tau = proposed;
+            return true;
+        }
+        // a non-finite solution cannot be accepted, and without tau_min the
+        // step would shrink forever
+        if( tau <= options.tau_min || ++rejections > max_rejections ) {
+            cerr << "The adaptive time step failed at time " << time << " with tau = " << tau << "." << endl;
             return false;
         }
-        update_pressure();
+
+        rejected_steps++;
+        tau = proposed;
+        copy_n( pressure_saved.getData(), n, pressure.getData() );
+        copy_n( ptrace_saved.getData(), mesh.num_edges(), ptrace.getData() );
+        if( bdf2 )
+            copy_n( pressure_history_saved.getData(), n, pressure_history.getData() );
+        history_tau = history_tau_saved;
+    }
+}
+
+// Update the counter of consecutive steps with the relative rate of change
+// of pressure and ptrace below options.steady_tolerance. The maximum norm of
+// the change is computed in the same pass which saves the current state for
+// the next check. Returns true when the steady state is reached.
+bool Solver::check_steady_state( const RealType & tau )
+{
+    RealType change = 0.0;
+    bool finite = true;
+    RealType* previous = pressure_previous.getData();
+    for( IndexType cell = 0; cell < mesh.num_cells(); cell++ ) {
+        const RealType p = pressure[ cell ];
+        finite &= isfinite( p );
+        change = fmax( change, fabs( p - previous[ cell ] ) / fabs( p ) );
+        previous[ cell ] = p;
+    }
+    previous = ptrace_previous.getData();
+    for( IndexType edge = 0; edge < mesh.num_edges(); edge++ ) {
+        const RealType t = ptrace[ edge ];
+        finite &= isfinite( t );
+        change = fmax( change, fabs( t - previous[ edge ] ) / fabs( t ) );
+        previous[ edge ] = t;
+    }
+
+    // the rate is independent of the step length, so very short steps
+    // (e.g. those hitting the snapshot times) do not fake convergence;
+    // fmax drops NaN, so a non-finite state never counts as steady
+    if( finite && change / tau <= options.steady_tolerance )
+        steady_count++;
+    else
+        steady_count = 0;
+    steady = steady_count >= options.steady_steps;
+    return steady;
+}
+
+// Replace the transient state by the solution of the steady problem, i.e.
+// one step with infinite length (lambda = 0). With lagged coefficients this
+// is a single linear solve from the nearly steady state, the nonlinear
+// iterations solve the steady problem exactly.
+bool Solver::solve_steady_state( const RealType & time )
+{
+    out() << "Steady-state solve" << endl;
+    return step( time, HUGE_VAL );
+}
+
+// Remember the counters at the beginning of a time step, publish_step_record
+// sends their changes during the step to the telemetry.
+void Solver::begin_step_record( const RealType & time )
+{
+    if( ! telemetry.active() )
+        return;
+    step_record.step = ++step_count;
+    step_record.time = time;
+    for( int phase = 0; phase < Profiler::NUM_PHASES; phase++ )
+        step_record.phase_seconds[ phase ] = profiler.total( (Profiler::Phase) phase );
+    step_record.nonlinear_iterations = nonlinear_iterations;
+    step_record.nonlinear_failures = nonlinear_failures;
+    step_record.krylov_iterations = schwarz.iterations;
+    step_record.rejected_steps = rejected_steps;
+    step_start = chrono::steady_clock::now();
+}
+
+void Solver::publish_step_record( const RealType & tau )
+{
+    if( ! telemetry.active() )
+        return;
+    StepRecord record = step_record;
+    record.tau = tau;
+    record.seconds = chrono::duration< double >( chrono::steady_clock::now() - step_start ).count();
+    for( int phase = 0; phase < Profiler::NUM_PHASES; phase++ )
+        record.phase_seconds[ phase ] = profiler.total( (Profiler::Phase) phase ) - step_record.phase_seconds[ phase ];
+    record.nonlinear_iterations = nonlinear_iterations - step_record.nonlinear_iterations;
+    record.nonlinear_failures = nonlinear_failures - step_record.nonlinear_failures;
+    record.nonlinear_residual = nonlinear_last_residual;
+    record.krylov_iterations = schwarz.iterations - step_record.krylov_iterations;
+    record.rejected_steps = rejected_steps - step_record.rejected_steps;
+    telemetry.publish( record );
+}
+
+bool Solver::solve( const RealType & time_start, const RealType & time_stop )
+{
+    RealType time = time_start;
+
+    while( time < time_stop ) {
+        if( options.adaptive_tolerance > 0.0 ) {
+            const RealType clamped_tau = fmin( adaptive_tau, time_stop - time );
+            RealType current_tau = clamped_tau;
+            RealType next_tau = adaptive_tau;
+
+            Trace::Scope trace( "time step" );
+            begin_step_record( time );
+            if( ! adaptive_step( time, current_tau, next_tau ) )
+                return false;
+            publish_step_record( current_tau );
+
+            // a step shortened only to hit time_stop must not shrink the controller's step
+            if( current_tau == clamped_tau && clamped_tau < adaptive_tau )
+                adaptive_tau = fmax( adaptive_tau, next_tau );
+            else
+                adaptive_tau = next_tau;
+
+            time += current_tau;
+            if( options.steady_tolerance > 0.0 && check_steady_state( current_tau ) )
+                break;
+            continue;
+        }
+
+        RealType current_tau = fmin( tau, time_stop - time );
+
+        Trace::Scope trace( "time step" );
+        begin_step_record( time );
+        if( ! step( time, current_tau ) )
+            return false;
+        publish_step_record( current_tau );
 
         time += current_tau;
+        if( options.steady_tolerance > 0.0 && check_steady_state( current_tau ) )
+            break;
+    }
+
+    return true;
+}
+
+// Interpolate the cell pressures of a coarser mesh covering the same area
+// bilinearly (between the cell centers, constant next to the boundary) and
+// set the traces to the averages of the adjacent cells, or to the Dirichlet
+// values. The result is the initial state of the fine run, i.e. also the
+// initial iterate of the nonlinear and linear solvers.
+void Solver::interpolate_state( const RectangularMesh & coarse_mesh, const Vector & coarse_pressure )
+{
+    const int coarse_rows = coarse_mesh.get_rows();
+    const int coarse_cols = coarse_mesh.get_cols();
+    const RealType ratio_x = mesh.get_hx() / coarse_mesh.get_hx();
+    const RealType ratio_y = mesh.get_hy() / coarse_mesh.get_hy();
+
+    // position of the fine cell center in the coarse cell-center grid:
+    // index of the lower neighbour and the interpolation weight
+    auto locate = [] ( RealType position, int size, int & lower, RealType & weight ) {
+        position = fmin( fmax( position, 0.0 ), size - 1 );
+        lower = min( (int) position, max( size - 2, 0 ) );
+        weight = position - lower;
+    };
+
+    ptrace.setAllElements( 0.0 );
+    vector< unsigned char > count( mesh.num_edges(), 0 );
+    mesh.for_each_cell( [&] ( int cell, int row, int col, const int* edges ) {
+        int I, J;
+        RealType wx, wy;
+        locate( ( col + 0.5 ) * ratio_x - 0.5, coarse_cols, I, wx );
+        locate( ( row + 0.5 ) * ratio_y - 0.5, coarse_rows, J, wy );
+        const int I1 = min( I + 1, coarse_cols - 1 );
+        const int J1 = min( J + 1, coarse_rows - 1 );
+        const RealType p = ( 1 - wy ) * ( ( 1 - wx ) * coarse_pressure[ J * coarse_cols + I ] + wx * coarse_pressure[ J * coarse_cols + I1 ] )
+                         + wy * ( ( 1 - wx ) * coarse_pressure[ J1 * coarse_cols + I ] + wx * coarse_pressure[ J1 * coarse_cols + I1 ] );
+        pressure[ cell ] = p;
+        for( int i = 0; i < 4; i++ ) {
+            ptrace[ edges[ i ] ] += p;
+            count[ edges[ i ] ]++;
+        }
+    } );
+
+    for( IndexType edge = 0; edge < mesh.num_edges(); edge++ ) {
+        if( mesh.is_dirichlet_boundary( edge ) )
+            ptrace[ edge ] = pD[ edge ];
+        else
+            ptrace[ edge ] /= count[ edge ];
+    }
+}
+
+// Mesh sequencing: simulate the initial interval on the coarse mesh and
+// start the fine run from the interpolated state.
+bool Solver::run_coarse_stage( void )
+{
+    const unsigned c = options.coarsening;
+    if( mesh_cols % c != 0 || mesh_rows % c != 0 ) {
+        cerr << "The mesh size " << mesh_cols << "x" << mesh_rows << " is not divisible by the coarsening factor " << c << "." << endl;
+        return false;
+    }
+
+    SolverOptions coarse_options = options;
+    coarse_options.coarsening = 1;
+    coarse_options.steady_tolerance = 0.0;
+    coarse_options.final_time = fmin( final_time, snapshot_period * ceil( options.coarse_time / snapshot_period ) );
+    coarse_options.snapshot_period = snapshot_period;
+    // the fine stage writes the telemetry file
+    coarse_options.telemetry_file = "";
+
+    auto start = chrono::steady_clock::now();
+    Solver coarse( output_prefix + "-coarse", mesh_cols / c, mesh_rows / c, tau, time_step_order, coarse_options );
+    if( ! coarse.run() ) {
+        cerr << "Failed to run the coarse stage." << endl;
+        return false;
     }
+    interpolate_state( coarse.get_mesh(), coarse.get_pressure() );
+    initial_time = coarse_options.final_time;
+    auto stop = chrono::steady_clock::now();
 
+    out() << "Coarse stage on " << mesh_cols / c << "x" << mesh_rows / c << " mesh until time " << initial_time
+          << ": " << chrono::duration< double >( stop - start ).count() << " s" << endl;
     return true;
 }
 
@@ -272,16 +1219,36 @@ bool Solver::run( void )
         return false;
     }
 
+    // tau from the command line, the coarse stage refines it for its mesh
+    const RealType initial_tau = tau;
+    if( options.coarsening > 1 && options.coarse_time > 0.0 ) {
+        if( ! run_coarse_stage() )
+            return false;
+    }
+    auto start = chrono::steady_clock::now();
+
     // update tau according to mesh refinement
-    tau = tau * pow( fmin( mesh.get_hx(), mesh.get_hy() ), time_step_order );
-    cout << "Refined time step: " << tau << endl;
-    // initialize
+    tau = initial_tau * pow( fmin( mesh.get_hx(), mesh.get_hy() ), time_step_order );
+    out() << "Refined time step: " << tau << endl;
+    adaptive_tau = tau;
+    // initialize, snapshots are numbered from time 0
     RealType time = initial_time;
-    IndexType step = 0;
-    const IndexType final_step = ceil( (final_time - initial_time) / snapshot_period );
+    IndexType step = lround( initial_time / snapshot_period );
+    const IndexType final_step = step + ceil( (final_time - initial_time) / snapshot_period );
+
+    if( ! telemetry.start( options.verbose ? &cout : nullptr, options.progress, options.progress_interval, options.telemetry_file ) )
+        return false;
+
+    if( options.snapshot_format == "binary" && ! open_series() )
+        return false;
 
     // save initial condition
-    pressure.save( output_prefix + "-" + pad_number( step ) + ".dat" );
+    save_snapshot( step, time );
+
+    if( options.steady_tolerance > 0.0 ) {
+        copy_n( pressure.getData(), mesh.num_cells(), pressure_previous.getData() );
+        copy_n( ptrace.getData(), mesh.num_edges(), ptrace_previous.getData() );
+    }
 
     while( step < final_step ) {
         RealType current_tau = fmin( snapshot_period, final_time - time );
@@ -290,13 +1257,145 @@ bool Solver::run( void )
         if( ! status )
             return false;
 
+        if( steady ) {
+            // no more steps are published; the queued progress lines precede the message
+            telemetry.stop();
+            // the final snapshot is written regardless of the skipped periods
+            out() << "Steady state reached in the period starting at time " << time << endl;
+            if( options.steady_solve && ! solve_steady_state( time ) )
+                return false;
+            save_snapshot( final_step, final_time );
+            break;
+        }
+
         step++;
         time += current_tau;
 
         // make snapshot
-        pressure.save( output_prefix + "-" + pad_number( step ) + ".dat" );
+        save_snapshot( step, time );
+    }
+    // the progress lines precede the summary
+    telemetry.stop();
+    if( options.snapshot_buffers > 0 ) {
+        Profiler::Scope scope( profiler, Profiler::SNAPSHOT );
+        if( ! snapshots.finish() )
+            return false;
+        out() << "Snapshot writer: " << snapshots.written << " snapshots, " << snapshots.waits
+              << " waits for a free buffer (" << snapshots.wait_seconds << " s)" << endl;
+    }
+    if( series.is_open() ) {
+        Profiler::Scope scope( profiler, Profiler::SNAPSHOT );
+        if( ! series.close() ) {
+            cerr << "Failed to write the time series " << output_prefix << ".snap." << endl;
+            return false;
+        }
+    }
+
+    if( options.nonlinear != "none" ) {
+        out() << "Nonlinear iteration (" << options.nonlinear << "): " << nonlinear_iterations << " iterations in "
+             << nonlinear_steps << " steps, at most " << max_nonlinear_iterations << " per step, "
+             << nonlinear_failures << " steps not converged, " << line_search_reductions << " line search reductions" << endl;
     }
+    if( options.integrator == "bdf2" )
+        out() << "BDF2: " << euler_restarts << " restarts with backward Euler" << endl;
+    if( options.adaptive_tolerance > 0.0 ) {
+        out() << "Adaptive time stepping: " << accepted_steps << " accepted steps, "
+             << rejected_steps << " rejected steps" << endl;
+    }
+    if( options.linear_solver == "schwarz" ) {
+        out() << "Schwarz solver: " << schwarz.iterations << " GMRES iterations in " << schwarz.solves << " solves" << endl;
+    }
+    if( options.coarsening > 1 && options.coarse_time > 0.0 ) {
+        auto stop = chrono::steady_clock::now();
+        out() << "Fine stage from time " << initial_time << ": " << chrono::duration< double >( stop - start ).count() << " s" << endl;
+    }
+    profiler.report( out() );
 
     return true;
 }
 
+
+bool Solver::dry_run( void )
+{
+    if( ! init_main_system() )
+        return false;
+    FactorizationEstimate estimate;
+    if( ! mainMatrix.estimate_factorization( estimate ) )
+        return false;
+
+    // the topology and the matrix pattern (with its values) are already resident
+    const size_t resident = resident_memory();
+    const size_t arrays = estimate_array_memory( mesh.num_cells(), mesh.num_edges(), options );
+    const double peak = resident + arrays + estimate.peak_bytes;
+
+    // time per step modelled as a * cells + b * flops of the factorization,
+    // fitted to a few steps of two small problems with the same options
+    const IndexType sizes[ 2 ] = { 16, 48 };
+    double cells[ 2 ], flops[ 2 ], seconds[ 2 ];
+    SolverOptions calibration_options = options;
+    calibration_options.verbose = false;
+    calibration_options.telemetry_file = "";
+    calibration_options.adaptive_tolerance = 0.0;
+    calibration_options.steady_tolerance = 0.0;
+    calibration_options.coarsening = 1;
+    for( int k = 0; k < 2; k++ ) {
+        const unsigned steps = 4;
+        Solver calibration( output_prefix + "-calibration", sizes[ k ], sizes[ k ], tau, 0, calibration_options );
+        FactorizationEstimate calibration_estimate;
+        // the first step includes the symbolic analysis
+        if( ! calibration.init() || ! calibration.mainMatrix.estimate_factorization( calibration_estimate )
+                || ! calibration.step( 0.0, tau ) ) {
+            cerr << "Failed to run the calibration problem." << endl;
+            return false;
+        }
+        auto start = chrono::steady_clock::now();
+        for( unsigned i = 1; i <= steps; i++ ) {
+            if( ! calibration.step( i * tau, tau ) ) {
+                cerr << "Failed to run the calibration problem." << endl;
+                return false;
+            }
+        }
+        auto stop = chrono::steady_clock::now();
+        cells[ k ] = calibration.mesh.num_cells();
+        flops[ k ] = calibration_estimate.flops;
+        seconds[ k ] = chrono::duration< double >( stop - start ).count() / steps;
+    }
+    const double det = cells[ 0 ] * flops[ 1 ] - cells[ 1 ] * flops[ 0 ];
+    double a = ( seconds[ 0 ] * flops[ 1 ] - seconds[ 1 ] * flops[ 0 ] ) / det;
+    double b = ( cells[ 0 ] * seconds[ 1 ] - cells[ 1 ] * seconds[ 0 ] ) / det;
+    // timing noise on the small problems, attribute everything to one term
+    if( a < 0.0 ) {
+        a = 0.0;
+        b = seconds[ 1 ] / flops[ 1 ];
+    }
+    else if( b < 0.0 ) {
+        a = seconds[ 1 ] / cells[ 1 ];
+        b = 0.0;
+    }
+    const double step_time = a * mesh.num_cells() + b * estimate.flops;
+
+    auto mib = [] ( double bytes ) { return bytes / 1024 / 1024; };
+    out() << fixed << setprecision( 1 );
+    out() << "Dry run: " << mesh_cols << "x" << mesh_rows << " mesh, " << mesh.num_edges() << " unknowns, "
+          << mainMatrix.nonzeros() << " non-zeros" << endl;
+    out() << "  vectors:                  " << mib( arrays ) << " MiB" << endl;
+    out() << "  main matrix (CSR):        " << mib( mainMatrix.memory_usage() ) << " MiB" << endl;
+    out() << "  symbolic factorization:   " << mib( estimate.symbolic_bytes ) << " MiB" << endl;
+    out() << "  LU factors (estimate):    " << mib( estimate.numeric_bytes ) << " MiB, "
+          << scientific << setprecision( 3 ) << estimate.lnz << " + " << estimate.unz << " non-zeros, "
+          << estimate.flops << " flops" << fixed << setprecision( 1 ) << endl;
+    out() << "  factorization peak:       " << mib( estimate.peak_bytes ) << " MiB" << endl;
+    out() << "  resident now:             " << mib( resident ) << " MiB" << endl;
+    out() << "  projected peak RSS:       " << mib( peak ) << " MiB" << endl;
+    out() << scientific << setprecision( 3 );
+    out() << "  estimated time per step:  " << step_time << " s" << endl;
+    if( options.adaptive_tolerance == 0.0 ) {
+        const RealType refined_tau = tau * pow( fmin( mesh.get_hx(), mesh.get_hy() ), time_step_order );
+        const long steps = ceil( options.final_time / refined_tau );
+        out() << "  estimated total time:     " << steps * step_time << " s (" << steps << " steps)" << endl;
+    }
+    out() << defaultfloat << setprecision( 6 );
+    if( options.linear_solver != "umfpack" )
+        out() << "  note: the estimates assume the direct solver of the main system" << endl;
+    return true;
+}
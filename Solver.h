@@ -1,11 +1,110 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <ostream>
 #include <string>
+#include <vector>
 
+#include "CellKernels.h"
 #include "RectangularMesh.h"
+#include "SchwarzSolver.h"
+#include "SnapshotWriter.h"
+#include "TimeSeries.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "Telemetry.h"
 #include "Vector.h"
 #include "SparseMatrix.h"
 
+// options not covered by the Solver constructor
+struct SolverOptions
+{
+    // number of threads used for the assembly of the main system
+    unsigned threads = 1;
+    // instruction set of the per-cell kernels, empty for runtime detection
+    std::string isa;
+    // adaptive time stepping (step doubling), disabled when the tolerance is not positive
+    RealType adaptive_tolerance = 0.0;
+    // bounds of the adaptive time step (zero means unbounded)
+    RealType tau_min = 0.0;
+    RealType tau_max = 0.0;
+    // treatment of the nonlinearity: "none" (coefficients lagged from the
+    // previous step), "picard" or "newton"
+    std::string nonlinear = "none";
+    RealType nonlinear_tolerance = 1e-8;    // relative change of pressure
+    unsigned nonlinear_max_iterations = 20;
+    // time integrator: "euler" (backward Euler) or "bdf2" (variable-step
+    // BDF2 started by one backward Euler step)
+    std::string integrator = "euler";
+    // simulated time interval and the period of output snapshots
+    RealType final_time = 30.0;
+    RealType snapshot_period = 1.0;
+    // steady-state detection: the run stops when the relative rate of change
+    // of pressure and ptrace (per unit time) stays below the tolerance for
+    // steady_steps consecutive steps; disabled when the tolerance is not positive
+    RealType steady_tolerance = 0.0;
+    unsigned steady_steps = 3;
+    // finish with a direct solve of the steady problem (zero time derivative)
+    bool steady_solve = false;
+    // fused pipeline: one sweep over the cells after each linear solve
+    // updates pressure and lambda and assembles the next system; only for
+    // backward Euler with lagged coefficients and fixed time steps
+    bool fused = false;
+    // physical parameters (constant in the whole domain)
+    RealType permeability = 1e-10;
+    RealType porosity = 0.4;
+    // Dirichlet pressure on the top boundary grows linearly from
+    // dirichlet_base by dirichlet_gradient over the width of the domain
+    RealType dirichlet_base = 1e5;
+    RealType dirichlet_gradient = 1e3;
+    // progress and summary output on stdout
+    bool verbose = true;
+    // per-step progress lines (Telemetry::Verbosity): 0 none, 1 at most one
+    // per progress_interval seconds, 2 every step with the times of the phases
+    unsigned progress = Telemetry::PROGRESS;
+    RealType progress_interval = 1.0;
+    // JSON-lines file with a record of every time step (empty disables it)
+    std::string telemetry_file;
+    // snapshots are saved by a background thread from this many copies of
+    // pressure (see SnapshotWriter), zero saves them synchronously
+    unsigned snapshot_buffers = 2;
+    // snapshot format: "text" (one file of pressure per snapshot) or "binary"
+    // (pressure and ptrace of all snapshots in <output prefix>.snap, see
+    // TimeSeries.h), optionally stored in single precision
+    std::string snapshot_format = "text";
+    bool snapshot_float32 = false;
+    // mesh sequencing: the interval [0, coarse_time] (rounded up to whole
+    // snapshot periods) is simulated on the mesh coarsened `coarsening` times
+    // in both directions, the fine run starts from the interpolated state
+    unsigned coarsening = 1;
+    RealType coarse_time = 0.0;
+    // solver of the main system: "umfpack" (direct) or "schwarz" (GMRES with
+    // overlapping additive Schwarz preconditioner on strips of cell rows,
+    // `subdomains` strips, zero for one per thread, overlapping by `overlap`
+    // rows of cells)
+    std::string linear_solver = "umfpack";
+    unsigned subdomains = 0;
+    unsigned overlap = 1;
+    RealType krylov_tolerance = 1e-10;
+    // performance counters (perf_event_open) per phase in the profile
+    bool perf_counters = false;
+};
+
+// Mesh and per-cell topology of the Solver in the structure-of-arrays layout:
+// component i (local edge order bottom, top, left, right) of cell K is stored
+// at [i * num_cells + K]. The data are read-only after construction and
+// shared by all Solver instances on the same mesh.
+struct CellTopology
+{
+    RectangularMesh mesh;
+    std::vector< IndexType > cell_edges;        // edge ids
+    std::vector< unsigned char > cell_boundary; // boundary type of the cell's edges (Solver::BoundaryBits)
+    // cells split into two colors (checkerboard), cells of the same color
+    // do not share any edge and can be assembled concurrently
+    std::vector< IndexType > cell_colors[ 2 ];
+};
+
 class Solver
 {
 private:
@@ -15,11 +114,22 @@ private:
     IndexType mesh_rows;
     RealType tau;
     RealType time_step_order;
+    SolverOptions options;
 
-    RectangularMesh mesh;
     // parameters
     RealType area_width;
     RealType area_height;
+
+    // shared topology and shortcuts to its members
+    std::shared_ptr< const CellTopology > topology;
+    const RectangularMesh & mesh;
+    const std::vector< IndexType > & cell_edges;
+    const std::vector< unsigned char > & cell_boundary;
+    const std::vector< IndexType > ( & cell_colors )[ 2 ];
+
+    // stream without buffer which discards the output when not verbose
+    std::ostream null_output{ nullptr };
+
     RealType snapshot_period;
     RealType initial_time;
     RealType final_time;
@@ -35,36 +145,156 @@ private:
     // variables
     Vector pressure;
     Vector ptrace;
+    // term of the time derivative given by the previous states, i.e. the
+    // state at the beginning of the step for backward Euler
+    Vector pressure_old;
     // main system matrix + right-hand-side
     SparseMatrix mainMatrix;
     Vector rhs;
+    SchwarzSolver schwarz;
+    Profiler profiler;
+    // options.threads - 1 workers for parallel_for, the calling thread is the
+    // last one; created by init(), none for a single thread
+    std::unique_ptr< ThreadPool > pool;
+    // per-step records and snapshots, written by background threads
+    Telemetry telemetry;
+    // binary snapshot format; declared before the writer, whose thread may
+    // still append to it, so that the thread is joined first on destruction
+    TimeSeriesWriter series;
+    SnapshotWriter snapshots;
+    StepRecord step_record;                     // counters at the beginning of the step
+    std::chrono::steady_clock::time_point step_start;
+    unsigned step_count = 0;
     // auxiliary variables
     Vector alpha;
-    SparseMatrix beta;
     Vector lambda;
 
+    // per-cell data in the structure-of-arrays layout of CellTopology
+    Vector beta;
+    Vector G;                                   // gravity terms G_KE
+    // per-cell element stage: 4x4 local blocks (row-major) and local rhs,
+    // recomputed once per step and scattered into the main system
+    Vector localMatrix;
+    Vector localRhs;
+    // per-cell coefficients of the pressure reconstruction (see update_local_system),
+    // cellWeights uses the structure-of-arrays layout
+    Vector cellWeights;
+    Vector cellShift;
+
     RealType hxy;
     RealType hyx;
 
+    const CellKernels* kernels = nullptr;
+
+    // fused pipeline: enabled when supported by the other options, the main
+    // system assembled by the last sweep is valid for the step length fused_tau
+    bool fused = false;
+    RealType fused_tau = 0.0;
+
+    // adaptive time stepping
+    RealType adaptive_tau = 0.0;
+    Vector pressure_saved;
+    Vector pressure_full;
+    Vector ptrace_saved;
+    unsigned accepted_steps = 0;
+    unsigned rejected_steps = 0;
+    Vector pressure_history_saved;
+    RealType history_tau_saved = 0.0;
+
+    // BDF2: state before the last step and the length of the last step
+    // (zero when there is no history and the next step is backward Euler)
+    Vector pressure_history;
+    RealType history_tau = 0.0;
+    unsigned euler_restarts = 0;
+
+    // nonlinear iteration
+    Vector pressure_iterate;
+    Vector ptrace_iterate;
+    Vector delta_pressure;
+    Vector delta_ptrace;
+    Vector edgeResidual;
+    unsigned nonlinear_steps = 0;
+    unsigned nonlinear_iterations = 0;
+    unsigned max_nonlinear_iterations = 0;
+    unsigned nonlinear_failures = 0;
+    unsigned line_search_reductions = 0;
+    RealType nonlinear_last_residual = 0.0;
+
+    // steady-state detection
+    Vector pressure_previous;
+    Vector ptrace_previous;
+    unsigned steady_count = 0;
+    bool steady = false;
+
     // auxiliary methods
+    static std::shared_ptr< const CellTopology > shared_topology( RealType area_width, RealType area_height,
+                                                                  IndexType rows, IndexType cols );
+    static size_t estimate_array_memory( size_t cells, size_t edges, const SolverOptions & options );
+    std::ostream & out( void );
     bool allocateVectors( void );
     bool init( void );
-    RealType G_KE( IndexType cell, IndexType edge );
+    void init_cell_data( void );
+    bool init_main_system( void );
+    bool init_schwarz( void );
+    bool solve_main_system( Vector & x );
     bool update_auxiliary_vectors( const RealType & time, const RealType & tau );
-    bool update_main_system( const RealType & time );
+    void update_local_system( IndexType cell, RealType* B, RealType* r );
+    void update_newton_local_system( IndexType cell, RealType* B, RealType* r );
+    void scatter_local_system( IndexType cell, const RealType* B, const RealType* r, bool correction );
+    bool update_main_system( const RealType & time, bool newton = false );
+    void reconstruct_cells( const Vector & trace, Vector & result );
     bool update_pressure( void );
+    void fused_sweep( const RealType & tau );
+    RealType nonlinear_residual( void );
+    RealType line_search( const RealType & residual, RealType & new_residual, bool backtrack );
+    bool step( const RealType & time, const RealType & tau );
+    bool linear_step( const RealType & time, const RealType & tau );
+    bool nonlinear_step( const RealType & time, const RealType & tau );
+    bool adaptive_step( const RealType & time, RealType & tau, RealType & next_tau );
+    bool check_steady_state( const RealType & tau );
+    bool solve_steady_state( const RealType & time );
+    bool run_coarse_stage( void );
+    void interpolate_state( const RectangularMesh & coarse_mesh, const Vector & coarse_pressure );
     bool solve( const RealType & time_start, const RealType & time_stop );
+    void begin_step_record( const RealType & time );
+    void publish_step_record( const RealType & tau );
+    bool open_series( void );
+    void save_snapshot( IndexType number, const RealType & time );
 
     template< typename T >
     std::string pad_number( const T & number );
 
 public:
+    enum BoundaryBits : unsigned char {
+        DIRICHLET = 0x01,   // shifted by the local edge order
+        NEUMANN = 0x10,
+    };
+
     Solver( std::string output_prefix,
             IndexType size_x,
             IndexType size_y,
             RealType time_step,
-            RealType time_step_order );
+            RealType time_step_order,
+            const SolverOptions & options = SolverOptions() );
 
     bool run( void );
+
+    // Build only the pattern of the main system and run the symbolic
+    // analysis; report the memory of the vectors, the matrix and the LU
+    // factors, the projected peak RSS and the time per step extrapolated from
+    // 5 real time steps of two small calibration problems (16x16 and 48x48
+    // cells). Nothing of the full size is allocated apart from the mesh
+    // topology and the matrix pattern.
+    bool dry_run( void );
+
+    // rough estimate of the memory needed by a Solver instance in bytes
+    // (vectors, main matrix and its LU factors)
+    static size_t estimate_memory( IndexType size_x, IndexType size_y, const SolverOptions & options );
+
+    const RectangularMesh & get_mesh( void ) const { return mesh; };
+    const Vector & get_pressure( void ) const { return pressure; };
+    const Vector & get_ptrace( void ) const { return ptrace; };
+    const SchwarzSolver & get_schwarz( void ) const { return schwarz; };
+    const Profiler & get_profiler( void ) const { return profiler; };
 };
 
@@ -6,14 +6,342 @@
 #include <fstream>      // file streams (saving/loading CSR files)
 #include <sstream>      // string streams
 #include <iterator>     // iterators for standard containers and streams
+#include <iomanip>      // stream manipulators (cache file names)
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <cstdio>       // std::rename, std::remove
+#include <cstdlib>      // mkstemp
+#include <cstring>      // memcmp
+#include <sys/stat.h>   // fchmod
+#include <unistd.h>     // close
 #include <umfpack.h>
 
+#include "Memory.h"
 #include "SparseMatrix.h"
 #include "exceptions.h"
 
 using namespace std;
 
 
+namespace {
+
+/**
+ * Záznam v cache symbolických faktorizací. Kromě objektu Symbolic si pamatuje
+ * i celý vzor matice, aby kolize hashů nemohly vrátit cizí faktorizaci.
+ */
+struct SymbolicCacheEntry
+{
+    IndexType rows;
+    vector< IndexType > row_indexes;
+    vector< IndexType > column_indexes;
+    void* Symbolic;
+    size_t bytes;       ///< velikost objektu Symbolic a kopie vzoru evidovaná v Memory
+    unsigned users;     ///< počet matic, které faktorizaci právě používají
+    uint64_t last_use;  ///< pořadí posledního použití (pro LRU)
+};
+
+/**
+ * In-process cache symbolických faktorizací sdílená všemi instancemi SparseMatrix.
+ * Nepoužívané záznamy zůstávají v cache pro další matice se stejným vzorem,
+ * dokud jejich celková velikost nepřekročí limit; pak se uvolňují od nejdéle
+ * nepoužitých.
+ */
+struct SymbolicCache
+{
+    mutex lock;
+    multimap< uint64_t, SymbolicCacheEntry > entries;
+    size_t limit = 64 << 20;    ///< limit velikosti nepoužívaných záznamů v bajtech
+    uint64_t clock = 0;
+
+    void free_entry( SymbolicCacheEntry & entry )
+    {
+        umfpack_di_free_symbolic( &entry.Symbolic );
+        Memory::release( Memory::UMFPACK_SYMBOLIC, entry.bytes );
+    }
+
+    // uvolní nepoužívané záznamy nad limit, volá se se zamčeným lock
+    void evict( void )
+    {
+        while( true ) {
+            size_t unused = 0;
+            auto oldest = entries.end();
+            for( auto it = entries.begin(); it != entries.end(); ++it ) {
+                if( it->second.users > 0 )
+                    continue;
+                unused += it->second.bytes;
+                if( oldest == entries.end() || it->second.last_use < oldest->second.last_use )
+                    oldest = it;
+            }
+            if( unused <= limit )
+                return;
+            free_entry( oldest->second );
+            entries.erase( oldest );
+        }
+    }
+
+    ~SymbolicCache( void )
+    {
+        for( auto & item : entries )
+            free_entry( item.second );
+    }
+};
+
+SymbolicCache & symbolic_cache( void )
+{
+    static SymbolicCache cache;
+    return cache;
+}
+
+// size of a file in bytes, 0 if it cannot be read
+size_t file_size( const string & filename )
+{
+    ifstream file( filename.c_str(), ios::binary | ios::ate );
+    return file.good() ? (size_t) file.tellg() : 0;
+}
+
+// UMFPACK takes file names as non-const char*
+vector< char > c_filename( const string & filename )
+{
+    vector< char > buffer( filename.begin(), filename.end() );
+    buffer.push_back( '\0' );
+    return buffer;
+}
+
+// unique new file next to `filename` for writing before an atomic rename
+// (the name differs for every call, also between threads of one process),
+// empty string on failure
+string temporary_file( const string & filename )
+{
+    vector< char > name = c_filename( filename + ".tmp.XXXXXX" );
+    const int fd = mkstemp( &name[0] );
+    if( fd < 0 )
+        return "";
+    // mkstemp creates the file private, the cache may be shared with others
+    fchmod( fd, 0644 );
+    close( fd );
+    return string( &name[0] );
+}
+
+// The pattern of a cached symbolic factorization is stored next to it, the
+// factorization is used only if the pattern matches.
+const char pattern_magic[ 8 ] = { 'U', 'M', 'F', 'P', 'A', 'T', '1', '\0' };
+
+struct PatternHeader
+{
+    char magic[ 8 ];
+    uint64_t hash;
+    int64_t rows;
+    int64_t nnz;
+};
+
+bool save_pattern( const string & filename, uint64_t hash, IndexType rows,
+                   const vector< IndexType > & row_indexes, const vector< IndexType > & column_indexes )
+{
+    PatternHeader header;
+    memcpy( header.magic, pattern_magic, sizeof( header.magic ) );
+    header.hash = hash;
+    header.rows = rows;
+    header.nnz = column_indexes.size();
+    ofstream file( filename.c_str(), ios::binary | ios::trunc );
+    file.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+    file.write( reinterpret_cast< const char* >( row_indexes.data() ), row_indexes.size() * sizeof( IndexType ) );
+    file.write( reinterpret_cast< const char* >( column_indexes.data() ), column_indexes.size() * sizeof( IndexType ) );
+    file.close();
+    return ! file.fail();
+}
+
+bool check_pattern( const string & filename, uint64_t hash, IndexType rows,
+                    const vector< IndexType > & row_indexes, const vector< IndexType > & column_indexes )
+{
+    ifstream file( filename.c_str(), ios::binary );
+    PatternHeader header;
+    if( ! file.read( reinterpret_cast< char* >( &header ), sizeof( header ) )
+            || memcmp( header.magic, pattern_magic, sizeof( header.magic ) ) != 0
+            || header.hash != hash || header.rows != rows || header.nnz != (int64_t) column_indexes.size() )
+        return false;
+    vector< IndexType > stored_rows( row_indexes.size() ), stored_columns( column_indexes.size() );
+    file.read( reinterpret_cast< char* >( stored_rows.data() ), stored_rows.size() * sizeof( IndexType ) );
+    file.read( reinterpret_cast< char* >( stored_columns.data() ), stored_columns.size() * sizeof( IndexType ) );
+    // the file must end after the pattern
+    return file && file.peek() == EOF && stored_rows == row_indexes && stored_columns == column_indexes;
+}
+
+// write to a temporary file by `save` and rename it to `filename`
+template< typename Save >
+bool save_atomically( const string & filename, Save save )
+{
+    const string tmpname = temporary_file( filename );
+    if( tmpname.empty() )
+        return false;
+    if( ! save( tmpname ) || rename( tmpname.c_str(), filename.c_str() ) != 0 ) {
+        remove( tmpname.c_str() );
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+string SparseMatrix::_symbolic_cache_dir;
+
+void SparseMatrix::set_symbolic_cache_dir( const string & dir )
+{
+    _symbolic_cache_dir = dir;
+}
+
+/**
+ * FNV-1a hash vzoru matice (rozměry a indexová pole CSR).
+ */
+uint64_t
+SparseMatrix::_pattern_hash( void ) const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto update = [&hash] ( const void* data, size_t bytes ) {
+        const unsigned char* p = static_cast< const unsigned char* >( data );
+        for( size_t i = 0; i < bytes; i++ ) {
+            hash ^= p[ i ];
+            hash *= 1099511628211ULL;
+        }
+    };
+    update( &rows, sizeof( rows ) );
+    update( &cols, sizeof( cols ) );
+    update( _row_indexes.data(), _row_indexes.size() * sizeof( IndexType ) );
+    update( _column_indexes.data(), _column_indexes.size() * sizeof( IndexType ) );
+    return hash;
+}
+
+/**
+ * Nastaví Symbolic na symbolickou faktorizaci aktuálního vzoru matice. Hledá
+ * postupně v in-process cache, v adresáři nastaveném pomocí
+ * set_symbolic_cache_dir() a teprve nakonec volá umfpack_di_symbolic.
+ * Nově spočtená faktorizace se uloží do obou cache. Na disku je vedle
+ * faktorizace (.umf) uložen i vzor matice (.pattern), faktorizace se načte
+ * jen při shodě vzoru.
+ */
+bool
+SparseMatrix::_acquire_symbolic( const double* Control, double* Info )
+{
+    const uint64_t hash = _pattern_hash();
+    SymbolicCache & cache = symbolic_cache();
+
+    // the matrix becomes a user of the found entry
+    auto lookup = [&] () -> void* {
+        auto range = cache.entries.equal_range( hash );
+        for( auto it = range.first; it != range.second; ++it ) {
+            SymbolicCacheEntry & entry = it->second;
+            if( entry.rows == rows and entry.row_indexes == _row_indexes and entry.column_indexes == _column_indexes ) {
+                entry.users++;
+                entry.last_use = ++cache.clock;
+                return entry.Symbolic;
+            }
+        }
+        return nullptr;
+    };
+
+    {
+        lock_guard< mutex > guard( cache.lock );
+        Symbolic = lookup();
+        if( Symbolic )
+            return true;
+    }
+
+    // the cache is not locked while loading or computing, other threads may
+    // work on different patterns in the meantime
+    void* symbolic = nullptr;
+    size_t bytes = 0;
+    string filename;
+    if( not _symbolic_cache_dir.empty() ) {
+        stringstream ss;
+        ss << _symbolic_cache_dir << "/symbolic-" << hex << setw( 16 ) << setfill( '0' ) << hash
+           << dec << "-" << rows << "-" << _column_indexes.size();
+        filename = ss.str();
+        vector< char > fname = c_filename( filename + ".umf" );
+        if( ! check_pattern( filename + ".pattern", hash, rows, _row_indexes, _column_indexes )
+                or umfpack_di_load_symbolic( &symbolic, &fname[0] ) != UMFPACK_OK )
+            symbolic = nullptr;
+        else
+            // Info is not available, the saved object has about the same size
+            bytes = file_size( filename + ".umf" );
+    }
+
+    if( symbolic == nullptr ) {
+        int status = umfpack_di_symbolic( rows, rows, &_row_indexes[0], &_column_indexes[0], &_values[0], &symbolic, Control, Info );
+        if( status != UMFPACK_OK ) {
+            cerr << "error: symbolic reordering failed" << endl;
+            umfpack_di_report_status( Control, status );
+//           umfpack_di_report_control( Control );
+//           umfpack_di_report_info( Control, Info );
+            return false;
+        }
+        const double unit = Info[ UMFPACK_SIZE_OF_UNIT ];
+        bytes = Info[ UMFPACK_SYMBOLIC_SIZE ] * unit;
+        const double workspace = Info[ UMFPACK_SYMBOLIC_PEAK_MEMORY ] * unit - bytes;
+        if( workspace > 0 )
+            Memory::temporary( Memory::UMFPACK_WORKSPACE, workspace );
+
+        if( not filename.empty() ) {
+            // write under unique names and rename, concurrent runs and threads
+            // may share the directory; the pattern is published last, so a
+            // reader never pairs it with a partially written factorization
+            auto save_symbolic = [symbolic] ( const string & tmpname ) {
+                vector< char > fname = c_filename( tmpname );
+                return umfpack_di_save_symbolic( symbolic, &fname[0] ) == UMFPACK_OK;
+            };
+            auto save_pattern_file = [this, hash] ( const string & tmpname ) {
+                return save_pattern( tmpname, hash, rows, _row_indexes, _column_indexes );
+            };
+            if( not save_atomically( filename + ".umf", save_symbolic )
+                    or not save_atomically( filename + ".pattern", save_pattern_file ) )
+                cerr << "warning: failed to save symbolic factorization to " << filename << ".umf" << endl;
+        }
+    }
+
+    lock_guard< mutex > guard( cache.lock );
+    // another thread may have inserted the same pattern meanwhile
+    Symbolic = lookup();
+    if( Symbolic ) {
+        umfpack_di_free_symbolic( &symbolic );
+        return true;
+    }
+    // the copy of the pattern is accounted together with the factorization
+    bytes += ( _row_indexes.size() + _column_indexes.size() ) * sizeof( IndexType );
+    cache.entries.insert( make_pair( hash, SymbolicCacheEntry{ rows, _row_indexes, _column_indexes, symbolic, bytes, 1, ++cache.clock } ) );
+    Memory::allocate( Memory::UMFPACK_SYMBOLIC, bytes );
+    Symbolic = symbolic;
+    return true;
+}
+
+/**
+ * Vrátí symbolickou faktorizaci do cache (pokud ji matice používá). Záznam,
+ * který už žádná matice nepoužívá, může být z cache uvolněn.
+ */
+void
+SparseMatrix::_release_symbolic( void )
+{
+    if( Symbolic == nullptr )
+        return;
+    SymbolicCache & cache = symbolic_cache();
+    lock_guard< mutex > guard( cache.lock );
+    for( auto & item : cache.entries ) {
+        if( item.second.Symbolic == Symbolic ) {
+            item.second.users--;
+            break;
+        }
+    }
+    Symbolic = nullptr;
+    cache.evict();
+}
+
+void SparseMatrix::set_symbolic_cache_limit( size_t bytes )
+{
+    SymbolicCache & cache = symbolic_cache();
+    lock_guard< mutex > guard( cache.lock );
+    cache.limit = bytes;
+    cache.evict();
+}
+
+
 /**
  * Smaže i-tý prvek z polí _values a _column_indexes.
  */
@@ -38,12 +366,40 @@ SparseMatrix::_insert( IndexType i, IndexType column, RealType data )
     _column_indexes.insert( col_position, column );
 }
 
-SparseMatrix::~SparseMatrix( void )
+/**
+ * Zaeviduje v Memory změnu velikosti polí CSR od posledního volání.
+ */
+void
+SparseMatrix::_account_memory( void )
+{
+    const size_t bytes = memory_usage();
+    if( bytes > _accounted_bytes )
+        Memory::allocate( Memory::CSR, bytes - _accounted_bytes );
+    else if( bytes < _accounted_bytes )
+        Memory::release( Memory::CSR, _accounted_bytes - bytes );
+    _accounted_bytes = bytes;
+}
+
+/**
+ * Uvolní numerickou faktorizaci (pokud existuje).
+ */
+void
+SparseMatrix::_free_numeric( void )
 {
-    if( Symbolic )
-        umfpack_di_free_symbolic( &Symbolic );
-    if( Numeric )
+    if( Numeric ) {
         umfpack_di_free_numeric( &Numeric );
+        Numeric = nullptr;
+        Memory::release( Memory::UMFPACK_NUMERIC, _numeric_bytes );
+        _numeric_bytes = 0;
+    }
+}
+
+SparseMatrix::~SparseMatrix( void )
+{
+    // Symbolic is owned by the symbolic cache
+    _release_symbolic();
+    _free_numeric();
+    Memory::release( Memory::CSR, _accounted_bytes );
 }
 
 
@@ -56,14 +412,8 @@ bool SparseMatrix::setSize( const IndexType rows, const IndexType cols )
     _values.clear();
     _column_indexes.clear();
     _row_indexes.clear();
-    if( Symbolic ) {
-        umfpack_di_free_symbolic( &Symbolic );
-        Symbolic = nullptr;
-    }
-    if( Numeric ) {
-        umfpack_di_free_numeric( &Numeric );
-        Numeric = nullptr;
-    }
+    _release_symbolic();
+    _free_numeric();
     
     // update size
     this->rows = rows;
@@ -76,12 +426,14 @@ bool SparseMatrix::setSize( const IndexType rows, const IndexType cols )
     }
 
     _row_indexes.push_back( 0 );  // number of non-zero elements
+    _account_memory();
     return true;
 }
 
 /**
  * Nastaví prvek matice na zadanou hodnotu.
  * Vyvolá vyjímku, pokud jsou indexy mimo rozměry matice.
+ * Změna hodnoty zruší numerickou faktorizaci, změna vzoru i symbolickou.
  * @param row       index řádku (číslováno od 0)
  * @param column    index sloupce (číslováno od 0)
  * @param data      hodnota která se uloží do matice
@@ -93,43 +445,47 @@ SparseMatrix::setElement( const IndexType row, const IndexType column, const Rea
     if( row < 0 || row >= rows || column < 0 || column >= cols )
         throw BadIndex("matrix indexes out of bounds");
 
-    RealType current_value = getElement(row, column);
+    // ensure that _row_indexes has size of the index of the last non-zero row + 1
+    if( data != 0 ) {
+        while( (unsigned) row + 1 >= _row_indexes.size() )
+            _row_indexes.push_back( _row_indexes.back() );
+    }
+    else if( (unsigned) row + 1 >= _row_indexes.size() ) {
+        // nothing to remove
+        return true;
+    }
+
+    // find element index in _column_indexes (or index of the next element)
+    IndexType index = _row_indexes[row];
+    while (index < _row_indexes[row+1] and _column_indexes[index] < column)
+        index++;
+    // stored elements may have zero value (see resetValues), so test the pattern, not the value
+    bool found = index < _row_indexes[row+1] and _column_indexes[index] == column;
 
     // overwrite existing element
-    if (data != 0 and current_value != 0) {
-        // hledat index prvku v _column_indexes
-        IndexType index = _row_indexes[row];
-        while (index < _row_indexes[row+1] and _column_indexes[index] < column)
-            index++;
+    if (data != 0 and found) {
+        if( _values[index] != data )
+            _free_numeric();
         _values[index] = data;
     }
     // insert new element
-    else if (data != 0 and current_value == 0) {
-        // ensure that _row_indexes has size of the index of the last non-zero row + 1
-        while( (unsigned) row + 1 >= _row_indexes.size() )
-            _row_indexes.push_back( _row_indexes.back() );
-
-        // for next non-zero element find its index in _column_indexes
-        IndexType index = _row_indexes[row];
-        while (index < _row_indexes[row+1] and _column_indexes[index] <= column)
-            index++;
-
+    else if (data != 0 and not found) {
         // insert before the next non-zero element
         _insert(index, column, data);
+        _account_memory();
+        _release_symbolic();
+        _free_numeric();
 
         // fix row indexes
         for( unsigned i = row+1; i < _row_indexes.size(); i++ )
             _row_indexes[i]++;
     }
     // remove element (reset to zero)
-    else if (data == 0 and current_value != 0) {
-        // find element index in _column_indexes
-        IndexType index = _row_indexes[row];
-        while (index < _row_indexes[row+1] and _column_indexes[index] < column)
-            index++;
-
+    else if (data == 0 and found) {
         // reset element to zero
         _delete(index);
+        _release_symbolic();
+        _free_numeric();
 
         // fix row indexes
         for( unsigned i = row+1; i < _row_indexes.size(); i++ )
@@ -140,6 +496,43 @@ SparseMatrix::setElement( const IndexType row, const IndexType column, const Rea
     return true;
 }
 
+/**
+ * Přičte hodnotu k prvku, který už je ve vzoru matice uložen. Vzor matice se
+ * nemění, takže metodu lze volat souběžně z více vláken pro různé řádky.
+ * @param row       index řádku (číslováno od 0)
+ * @param column    index sloupce (číslováno od 0)
+ * @param data      hodnota která se přičte k prvku matice
+ * @return          false pokud prvek není ve vzoru matice
+ */
+bool
+SparseMatrix::addElement( const IndexType row, const IndexType column, const RealType & data )
+{
+    if( row < 0 || row >= rows || column < 0 || column >= cols )
+        throw BadIndex("matrix indexes out of bounds");
+
+    if( (unsigned) row + 1 >= _row_indexes.size() )
+        return false;
+
+    for( IndexType index = _row_indexes[row]; index < _row_indexes[row+1]; index++ ) {
+        if( _column_indexes[index] == column ) {
+            _values[index] += data;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Vynuluje všechny uložené prvky, vzor matice i symbolická faktorizace zůstávají.
+ */
+void
+SparseMatrix::resetValues( void )
+{
+    for( auto & value : _values )
+        value = 0.0;
+    _free_numeric();
+}
+
 /**
  * Přečte hodnotu prvku matice.
  * Vyvolá vyjímku, pokud jsou indexy mimo rozměry matice.
@@ -278,53 +671,93 @@ bool SparseMatrix::load( const string & filename )
     _values = tmp_vect_values;
     _column_indexes = tmp_vect_columns;
     _row_indexes = tmp_vect_rows;
+    _account_memory();
+    _release_symbolic();
+    _free_numeric();
     return true;
 }
 
 // solve linear system  A*x=rhs using UMFPACK
 bool SparseMatrix::linear_solve( Vector & x, Vector & rhs )
+{
+    return symbolic_factorization() && numeric_factorization() && solve_factorized( x, rhs );
+}
+
+/**
+ * Symbolická faktorizace (přeuspořádání) vzoru matice. Je potřeba jen pokud
+ * ještě není spočtena numerická faktorizace.
+ */
+bool SparseMatrix::symbolic_factorization( void )
 {
     if( rows != cols )
         throw string("can't solve linear system on non-square matrix");
-    if( x.getSize() != rows || rhs.getSize() != rows )
-        throw string("passed vectors don't match matrix dimensions");
+    if( Symbolic != nullptr || Numeric != nullptr )
+        return true;
 
-    int status = UMFPACK_OK;
     double Control[ UMFPACK_CONTROL ];
     double Info[ UMFPACK_INFO ];
+    // the symbolic cache relies on the same control parameters in every run
+    umfpack_di_defaults( Control );
 //    Control[ UMFPACK_PRL ] = 2;
+    return _acquire_symbolic( Control, Info );
+}
 
-    // symbolic reordering of the sparse matrix
-    // (only needed when we're going to do numeric factorization)
-    if( Symbolic == nullptr && Numeric == nullptr ) {
-        status = umfpack_di_symbolic( rows, rows, &_row_indexes[0], &_column_indexes[0], &_values[0], &Symbolic, Control, Info );
-        if( status != UMFPACK_OK ) {
-            cerr << "error: symbolic reordering failed" << endl;
-            umfpack_di_report_status( Control, status );
-//           umfpack_di_report_control( Control );
-//           umfpack_di_report_info( Control, Info );
-            return false;
-        }
-    }
+/**
+ * Numerická faktorizace aktuálních hodnot matice, zůstává platná až do změny
+ * hodnot pomocí resetValues, setElement nebo load. Metoda addElement ji
+ * nezruší (volá se souběžně z více vláken), proto se před sestavením matice
+ * volá resetValues.
+ */
+bool SparseMatrix::numeric_factorization( void )
+{
+    if( Numeric != nullptr )
+        return true;
+    if( ! symbolic_factorization() )
+        return false;
 
-    // numeric factorization
-    if( Numeric == nullptr ) {
-        status = umfpack_di_numeric( &_row_indexes[0], &_column_indexes[0], &_values[0], Symbolic, &Numeric, Control, Info );
-        if( status != UMFPACK_OK ) {
-            cerr << "error: numeric factorization failed" << endl;
-            umfpack_di_report_status( Control, status );
+    double Control[ UMFPACK_CONTROL ];
+    double Info[ UMFPACK_INFO ];
+    umfpack_di_defaults( Control );
+
+    int status = umfpack_di_numeric( &_row_indexes[0], &_column_indexes[0], &_values[0], Symbolic, &Numeric, Control, Info );
+    if( status != UMFPACK_OK ) {
+        cerr << "error: numeric factorization failed" << endl;
+        umfpack_di_report_status( Control, status );
 //           umfpack_di_report_control( Control );
 //           umfpack_di_report_info( Control, Info );
-            return false;
-        }
+        return false;
     }
 
+    // the peak includes the Symbolic and Numeric objects
+    const double unit = Info[ UMFPACK_SIZE_OF_UNIT ];
+    _numeric_bytes = Info[ UMFPACK_NUMERIC_SIZE ] * unit;
+    Memory::allocate( Memory::UMFPACK_NUMERIC, _numeric_bytes );
+    const double workspace = ( Info[ UMFPACK_PEAK_MEMORY ] - Info[ UMFPACK_NUMERIC_SIZE ] - Info[ UMFPACK_SYMBOLIC_SIZE ] ) * unit;
+    if( workspace > 0 )
+        Memory::temporary( Memory::UMFPACK_WORKSPACE, workspace );
+    return true;
+}
+
+/**
+ * Vyřeší soustavu s již spočtenou numerickou faktorizací.
+ */
+bool SparseMatrix::solve_factorized( Vector & x, Vector & rhs )
+{
+    if( x.getSize() != rows || rhs.getSize() != rows )
+        throw string("passed vectors don't match matrix dimensions");
+    if( Numeric == nullptr && ! numeric_factorization() )
+        return false;
+
+    double Control[ UMFPACK_CONTROL ];
+    double Info[ UMFPACK_INFO ];
+    umfpack_di_defaults( Control );
+
     // umfpack expects Compressed Sparse Column format, we have Compressed Sparse Row
     // so we need to solve  A^T * x = rhs
     int sys = UMFPACK_Aat;
 
     // solve with specified right-hand-side
-    status = umfpack_di_solve( sys, &_row_indexes[0], &_column_indexes[0], &_values[0], &x[0], &rhs[0], Numeric, Control, Info );
+    int status = umfpack_di_solve( sys, &_row_indexes[0], &_column_indexes[0], &_values[0], &x[0], &rhs[0], Numeric, Control, Info );
     if( status != UMFPACK_OK ) {
         cerr << "error: umfpack_di_solve failed" << endl;
             umfpack_di_report_status( Control, status );
@@ -338,11 +771,128 @@ bool SparseMatrix::linear_solve( Vector & x, Vector & rhs )
     return true;
 }
 
+/**
+ * Vynásobí vektor maticí: y = A * x.
+ */
+void SparseMatrix::multiply( const Vector & x, Vector & y ) const
+{
+    if( x.getSize() != cols || y.getSize() != rows )
+        throw string("passed vectors don't match matrix dimensions");
+    multiply( x.getData(), y.getData(), 0, rows );
+}
+
+/**
+ * Spočítá řádky first_row, ..., last_row - 1 součinu y = A * x. Různé
+ * rozsahy řádků lze počítat souběžně.
+ */
+void SparseMatrix::multiply( const RealType* x, RealType* y, IndexType first_row, IndexType last_row ) const
+{
+    const IndexType stored_rows = _row_indexes.size() - 1;
+    for( IndexType row = first_row; row < last_row; row++ ) {
+        RealType sum = 0.0;
+        if( row < stored_rows ) {
+            for( IndexType index = _row_indexes[row]; index < _row_indexes[row+1]; index++ )
+                sum += _values[index] * x[ _column_indexes[index] ];
+        }
+        y[row] = sum;
+    }
+}
+
+/**
+ * Uloží do result hlavní podmatici tvořenou řádky a sloupci s indexy
+ * z vektoru indexes (seřazenými vzestupně), očíslovanými od 0. Pokud se vzor
+ * podmatice od minulého volání nezměnil, zůstane zachována symbolická
+ * faktorizace a změní se jen hodnoty.
+ */
+void SparseMatrix::extract( const vector< IndexType > & indexes, SparseMatrix & result ) const
+{
+    const IndexType n = indexes.size();
+    vector< IndexType > row_indexes;
+    vector< IndexType > column_indexes;
+    vector< RealType > values;
+    row_indexes.reserve( n + 1 );
+    row_indexes.push_back( 0 );
+
+    for( IndexType k = 0; k < n; k++ ) {
+        const IndexType row = indexes[k];
+        if( row < 0 || row >= rows )
+            throw BadIndex("matrix indexes out of bounds");
+        if( (unsigned) row + 1 < _row_indexes.size() ) {
+            for( IndexType index = _row_indexes[row]; index < _row_indexes[row+1]; index++ ) {
+                // the mapping is monotone, so the local columns stay sorted
+                auto position = lower_bound( indexes.begin(), indexes.end(), _column_indexes[index] );
+                if( position != indexes.end() && *position == _column_indexes[index] ) {
+                    column_indexes.push_back( position - indexes.begin() );
+                    values.push_back( _values[index] );
+                }
+            }
+        }
+        row_indexes.push_back( column_indexes.size() );
+    }
+
+    if( result.rows == n and result.cols == n and result._row_indexes == row_indexes and result._column_indexes == column_indexes ) {
+        result._values.swap( values );
+        result._free_numeric();
+        result._account_memory();
+        return;
+    }
+
+    result.setSize( n, n );
+    result._row_indexes.swap( row_indexes );
+    result._column_indexes.swap( column_indexes );
+    result._values.swap( values );
+    result._account_memory();
+}
+
+/**
+ * Provede pouze symbolickou analýzu vzoru matice a z pole Info převezme odhady
+ * pro numerickou faktorizaci. Hodnoty prvků se nepoužijí (UMFPACK považuje
+ * všechny prvky vzoru za nenulové), takže stačí matice sestavená jen jako vzor.
+ */
+bool SparseMatrix::estimate_factorization( FactorizationEstimate & estimate ) const
+{
+    if( rows != cols )
+        throw string("can't factorize non-square matrix");
+
+    double Control[ UMFPACK_CONTROL ];
+    double Info[ UMFPACK_INFO ];
+    umfpack_di_defaults( Control );
+
+    // the same transposed system as in linear_solve
+    void* symbolic = nullptr;
+    int status = umfpack_di_symbolic( rows, rows, &_row_indexes[0], &_column_indexes[0], nullptr, &symbolic, Control, Info );
+    if( status != UMFPACK_OK ) {
+        cerr << "error: symbolic reordering failed" << endl;
+        umfpack_di_report_status( Control, status );
+        return false;
+    }
+    umfpack_di_free_symbolic( &symbolic );
+
+    const double unit = Info[ UMFPACK_SIZE_OF_UNIT ];
+    estimate.symbolic_bytes = Info[ UMFPACK_SYMBOLIC_SIZE ] * unit;
+    estimate.numeric_bytes = Info[ UMFPACK_NUMERIC_SIZE_ESTIMATE ] * unit;
+    estimate.peak_bytes = Info[ UMFPACK_PEAK_MEMORY_ESTIMATE ] * unit;
+    estimate.flops = Info[ UMFPACK_FLOPS_ESTIMATE ];
+    estimate.lnz = Info[ UMFPACK_LNZ_ESTIMATE ];
+    estimate.unz = Info[ UMFPACK_UNZ_ESTIMATE ];
+    return true;
+}
+
+/**
+ * Vrátí počet bajtů alokovaných pro pole formátu CSR.
+ */
+size_t SparseMatrix::memory_usage( void ) const
+{
+    return _values.capacity() * sizeof( RealType )
+         + ( _column_indexes.capacity() + _row_indexes.capacity() ) * sizeof( IndexType );
+}
+
 bool SparseMatrix::reserve( unsigned n )
 {
     try {
         _values.reserve( n );
         _column_indexes.reserve( n );
+        _account_memory();
         return true;
     } catch (...) {
         return false;
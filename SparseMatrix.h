@@ -7,11 +7,25 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
 
 #include "Matrix.h"
 #include "Vector.h"
 
 
+/**
+ * @brief   Odhady UMFPACKu pro numerickou faktorizaci získané ze symbolické analýzy.
+ */
+struct FactorizationEstimate
+{
+    double symbolic_bytes = 0.0;    ///< velikost objektu Symbolic
+    double numeric_bytes = 0.0;     ///< velikost objektu Numeric (faktory LU)
+    double peak_bytes = 0.0;        ///< špičková paměť během numerické faktorizace
+    double flops = 0.0;             ///< počet operací numerické faktorizace
+    double lnz = 0.0;               ///< počet nenulových prvků L
+    double unz = 0.0;               ///< počet nenulových prvků U
+};
+
 /**
  * @brief   Řídká matice, prvky uloženy ve formátu <a href="http://netlib.org/linalg/html_templates/node91.html">CSR</a>.
  */
@@ -27,10 +41,26 @@ private:
     void _insert( IndexType i, IndexType column, RealType data );    // vložit data na i-tou pozici do _values, nastavit column v _column_indexes
 
     // UMFPACK objects
-    void* Symbolic = nullptr;
+    void* Symbolic = nullptr;       // owned by the symbolic cache, shared by matrices with the same pattern
     void* Numeric = nullptr;
 
+    // bytes registered in Memory for the CSR arrays and for Numeric
+    size_t _accounted_bytes = 0;
+    size_t _numeric_bytes = 0;
+    void _account_memory( void );   // register the change of memory_usage()
+    void _free_numeric( void );
+
+    uint64_t _pattern_hash( void ) const;   // hash of the sparsity pattern, key of the symbolic cache
+    bool _acquire_symbolic( const double* Control, double* Info );  // get Symbolic from the cache or compute it
+    void _release_symbolic( void );     // stop using Symbolic, the cache may free it
+
+    static std::string _symbolic_cache_dir;
+
 public:
+    SparseMatrix( void ) = default;
+    // a copy would share Symbolic and Numeric without owning them
+    SparseMatrix( const SparseMatrix & ) = delete;
+    SparseMatrix & operator=( const SparseMatrix & ) = delete;
     ~SparseMatrix( void );
 
     virtual bool setSize( const IndexType rows, const IndexType cols );
@@ -39,13 +69,46 @@ public:
     virtual bool setElement( const IndexType row, const IndexType col, const RealType & data );
     virtual RealType getElement( const IndexType row, const IndexType col ) const;
 
+    // fixed-pattern assembly: add to an element already stored in the pattern,
+    // reset all stored values to zero while keeping the pattern; addElement
+    // does not invalidate the numeric factorization, resetValues does
+    bool addElement( const IndexType row, const IndexType col, const RealType & data );
+    void resetValues( void );
+
     // file saving/loading
     virtual bool save( const std::string & filename ) const;
     virtual bool load( const std::string & filename );
 
     // solve linear system with UMFPACK
     bool linear_solve( Vector & x, Vector & rhs );
+    // the steps of linear_solve, each is skipped when its result is still
+    // valid (setElement and load invalidate them as needed)
+    bool symbolic_factorization( void );
+    bool numeric_factorization( void );
+    bool solve_factorized( Vector & x, Vector & rhs );
+
+    // y = A * x, optionally only for rows [first_row, last_row)
+    void multiply( const Vector & x, Vector & y ) const;
+    void multiply( const RealType* x, RealType* y, IndexType first_row, IndexType last_row ) const;
+
+    // principal submatrix of the rows/columns in `indexes` (sorted ascending);
+    // the symbolic factorization of `result` is kept when its pattern does not change
+    void extract( const std::vector< IndexType > & indexes, SparseMatrix & result ) const;
+
+    // symbolic analysis of the pattern only (the values are ignored), the
+    // factorization is not cached
+    bool estimate_factorization( FactorizationEstimate & estimate ) const;
 
     // reserve space for 'n' non-zero elements
     bool reserve( unsigned n );
+
+    // number of stored elements and bytes allocated by the CSR arrays
+    IndexType nonzeros( void ) const { return _column_indexes.size(); };
+    size_t memory_usage( void ) const;
+
+    // directory for the on-disk cache of symbolic factorizations (empty string disables it)
+    static void set_symbolic_cache_dir( const std::string & dir );
+    // limit of the in-process symbolic cache in bytes: the factorizations no
+    // matrix uses are kept up to this size, least recently used are freed first
+    static void set_symbolic_cache_limit( size_t bytes );
 };
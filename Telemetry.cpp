@@ -0,0 +1,179 @@
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Telemetry.h"
+
+using namespace std;
+
+namespace {
+
+// the consumer wakes up at least this often to drain the buffer
+const chrono::milliseconds poll_period( 50 );
+
+// JSON has no NaN and infinity
+void json_number( ostream & os, double value )
+{
+    if( std::isfinite( value ) )
+        os << value;
+    else
+        os << "null";
+}
+
+} // namespace
+
+Telemetry::Telemetry( unsigned capacity )
+{
+    uint64_t size = 1;
+    while( size < capacity )
+        size *= 2;
+    mask = size - 1;
+}
+
+Telemetry::~Telemetry( void )
+{
+    stop();
+}
+
+bool Telemetry::start( ostream* console, unsigned verbosity, double interval, const string & json_file )
+{
+    stop();
+    this->console = ( verbosity > QUIET ) ? console : nullptr;
+    this->verbosity = verbosity;
+    this->interval = interval;
+    if( ! json_file.empty() ) {
+        json.open( json_file.c_str() );
+        if( json.fail() ) {
+            cerr << "Unable to open the telemetry file " << json_file << "." << endl;
+            return false;
+        }
+        json << setprecision( 12 );
+    }
+    if( this->console == nullptr && ! json.is_open() )
+        return true;
+
+    if( ! buffer )
+        buffer.reset( new StepRecord[ mask + 1 ] );
+    stopping = false;
+    worker = thread( &Telemetry::consume, this );
+    return true;
+}
+
+void Telemetry::stop( void )
+{
+    if( ! worker.joinable() )
+        return;
+    {
+        lock_guard< mutex > guard( lock );
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    if( json.is_open() )
+        json.close();
+}
+
+void Telemetry::consume( void )
+{
+    typedef chrono::steady_clock Clock;
+    Clock::time_point last_line;
+    bool any_line = false;
+    // the last record skipped by the rate limit, shown at the end
+    StepRecord skipped;
+    bool have_skipped = false;
+
+    while( true ) {
+        bool stop;
+        {
+            unique_lock< mutex > guard( lock );
+            wake.wait_for( guard, poll_period, [this] () { return stopping; } );
+            stop = stopping;
+        }
+
+        const uint64_t h = head.load( memory_order_acquire );
+        for( uint64_t t = tail.load( memory_order_relaxed ); t < h; t++ ) {
+            const StepRecord & record = buffer[ t & mask ];
+            if( json.is_open() )
+                write_json( record );
+            if( console ) {
+                const Clock::time_point now = Clock::now();
+                if( verbosity >= STEPS || ! any_line || now - last_line >= chrono::duration< double >( interval ) ) {
+                    write_console( record );
+                    last_line = now;
+                    any_line = true;
+                    have_skipped = false;
+                }
+                else {
+                    skipped = record;
+                    have_skipped = true;
+                }
+            }
+            // the slot can be reused by the producer
+            tail.store( t + 1, memory_order_release );
+        }
+        if( json.is_open() )
+            json.flush();
+        if( console )
+            console->flush();
+
+        if( stop )
+            break;
+    }
+
+    if( console ) {
+        if( have_skipped )
+            write_console( skipped );
+        if( dropped_records() > 0 )
+            *console << "Telemetry: " << dropped_records() << " of " << published() + dropped_records()
+                     << " step records dropped (buffer full)" << endl;
+    }
+}
+
+void Telemetry::write_console( const StepRecord & record )
+{
+    // one write per line, other threads may print meanwhile
+    stringstream line;
+    line << "Time: " << record.time << "  (step " << record.step << ", tau " << record.tau << ", "
+         << fixed << setprecision( 3 ) << 1e3 * record.seconds << " ms" << defaultfloat << setprecision( 6 );
+    if( record.nonlinear_iterations > 0 ) {
+        line << ", " << record.nonlinear_iterations << " nonlinear iterations, residual " << record.nonlinear_residual;
+        if( record.nonlinear_failures > 0 )
+            line << " (not converged)";
+    }
+    if( record.krylov_iterations > 0 )
+        line << ", " << record.krylov_iterations << " GMRES iterations";
+    if( record.rejected_steps > 0 )
+        line << ", " << record.rejected_steps << " rejected";
+    line << ")\n";
+
+    if( verbosity >= STEPS ) {
+        line << "   " << fixed << setprecision( 3 );
+        const char* separator = " ";
+        for( int phase = 0; phase < Profiler::NUM_PHASES; phase++ ) {
+            if( record.phase_seconds[ phase ] > 0.0 ) {
+                line << separator << Profiler::phase_name( (Profiler::Phase) phase ) << " " << 1e3 * record.phase_seconds[ phase ] << " ms";
+                separator = ", ";
+            }
+        }
+        line << "\n";
+    }
+    *console << line.str();
+}
+
+void Telemetry::write_json( const StepRecord & record )
+{
+    json << "{\"step\": " << record.step << ", \"time\": ";
+    json_number( json, record.time );
+    json << ", \"tau\": ";
+    json_number( json, record.tau );
+    json << ", \"seconds\": " << record.seconds << ", \"phases_s\": {";
+    for( int phase = 0; phase < Profiler::NUM_PHASES; phase++ )
+        json << ( phase ? ", " : "" ) << "\"" << Profiler::field_name( (Profiler::Phase) phase ) << "\": " << record.phase_seconds[ phase ];
+    json << "}, \"nonlinear_iterations\": " << record.nonlinear_iterations
+         << ", \"nonlinear_failures\": " << record.nonlinear_failures << ", \"nonlinear_residual\": ";
+    json_number( json, record.nonlinear_residual );
+    json << ", \"krylov_iterations\": " << record.krylov_iterations
+         << ", \"rejected_steps\": " << record.rejected_steps << "}\n";
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "Profiler.h"
+
+// Record of one time step published by the Solver.
+struct StepRecord
+{
+    unsigned step = 0;                  // number of the step in the run
+    double time = 0.0;                  // time at the beginning of the step
+    double tau = 0.0;                   // length of the step
+    double seconds = 0.0;               // wall-clock time of the step
+    double phase_seconds[ Profiler::NUM_PHASES ] = {};
+    unsigned nonlinear_iterations = 0;
+    unsigned nonlinear_failures = 0;    // nonlinear solves not converged
+    double nonlinear_residual = 0.0;    // residual of the last nonlinear solve
+    unsigned krylov_iterations = 0;
+    unsigned rejected_steps = 0;        // attempts rejected by the adaptive stepping
+};
+
+// Asynchronous channel for the per-step progress. The solver thread copies a
+// record into a single-producer single-consumer ring buffer without locking
+// and without I/O; a background thread drains the buffer into the sinks:
+// progress lines on a console stream and a JSON-lines file with one object
+// per step. When the buffer is full the record is dropped and counted, the
+// producer never waits.
+class Telemetry
+{
+public:
+    enum Verbosity {
+        QUIET = 0,      // no progress lines
+        PROGRESS = 1,   // at most one line per interval (and the last step)
+        STEPS = 2,      // every step with the times of the phases
+    };
+
+    // capacity is rounded up to a power of two, the buffer is allocated by start()
+    explicit Telemetry( unsigned capacity = 1024 );
+    ~Telemetry( void );
+
+    Telemetry( const Telemetry & ) = delete;
+    Telemetry & operator=( const Telemetry & ) = delete;
+
+    // start the consumer thread; console may be nullptr, an empty json_file
+    // disables the JSON sink; nothing is started when there is no sink
+    bool start( std::ostream* console, unsigned verbosity, double interval, const std::string & json_file );
+    // write the remaining records and stop the consumer thread
+    void stop( void );
+
+    bool active( void ) const { return worker.joinable(); };
+
+    // called only from the producing thread
+    void publish( const StepRecord & record )
+    {
+        if( ! active() )
+            return;
+        const uint64_t h = head.load( std::memory_order_relaxed );
+        if( h - tail.load( std::memory_order_acquire ) > mask ) {
+            dropped.fetch_add( 1, std::memory_order_relaxed );
+            return;
+        }
+        buffer[ h & mask ] = record;
+        head.store( h + 1, std::memory_order_release );
+    }
+
+    uint64_t published( void ) const { return head.load( std::memory_order_relaxed ); };
+    uint64_t dropped_records( void ) const { return dropped.load( std::memory_order_relaxed ); };
+
+private:
+    std::unique_ptr< StepRecord[] > buffer;
+    uint64_t mask = 0;
+    // written by the producer and the consumer, respectively
+    alignas( 64 ) std::atomic< uint64_t > head{ 0 };
+    alignas( 64 ) std::atomic< uint64_t > tail{ 0 };
+    alignas( 64 ) std::atomic< uint64_t > dropped{ 0 };
+
+    // sinks, used only by the consumer thread
+    std::ostream* console = nullptr;
+    unsigned verbosity = PROGRESS;
+    double interval = 1.0;
+    std::ofstream json;
+
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void consume( void );
+    void write_console( const StepRecord & record );
+    void write_json( const StepRecord & record );
+};
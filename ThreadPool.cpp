@@ -0,0 +1,104 @@
+#include "ThreadPool.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool( unsigned threads, Task initialize )
+{
+    if( threads < 1 )
+        threads = 1;
+    for( unsigned t = 0; t < threads; t++ )
+        queues.emplace_back( new Queue );
+    for( unsigned t = 0; t < threads; t++ )
+        workers.emplace_back( [this, t, initialize] () {
+            if( initialize )
+                initialize( t );
+            work( t );
+        } );
+}
+
+ThreadPool::~ThreadPool( void )
+{
+    {
+        lock_guard< mutex > guard( lock );
+        stopping = true;
+    }
+    wake.notify_all();
+    for( auto & worker : workers )
+        worker.join();
+}
+
+void ThreadPool::submit( Task task )
+{
+    unsigned target;
+    {
+        lock_guard< mutex > guard( lock );
+        target = next++ % queues.size();
+        queued++;
+    }
+    {
+        lock_guard< mutex > guard( queues[ target ]->lock );
+        queues[ target ]->tasks.push_back( move( task ) );
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::wait( void )
+{
+    unique_lock< mutex > guard( lock );
+    done.wait( guard, [this] () { return queued == 0 && running == 0; } );
+}
+
+// Take the oldest task from the worker's own queue or steal the newest one
+// from another queue.
+bool ThreadPool::pop( unsigned worker, Task & task, bool & steal )
+{
+    for( unsigned i = 0; i < queues.size(); i++ ) {
+        Queue & queue = *queues[ ( worker + i ) % queues.size() ];
+        lock_guard< mutex > guard( queue.lock );
+        if( queue.tasks.empty() )
+            continue;
+        steal = i > 0;
+        if( ! steal ) {
+            task = move( queue.tasks.front() );
+            queue.tasks.pop_front();
+        }
+        else {
+            task = move( queue.tasks.back() );
+            queue.tasks.pop_back();
+        }
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::work( unsigned worker )
+{
+    while( true ) {
+        {
+            unique_lock< mutex > guard( lock );
+            wake.wait( guard, [this] () { return queued > 0 || stopping; } );
+            if( queued == 0 )
+                return;
+            // reserve one of the submitted tasks
+            queued--;
+            running++;
+        }
+
+        Task task;
+        bool steal = false;
+        // the reserved task may be pushed to its queue just after the
+        // reservation, so retry until it is found
+        while( ! pop( worker, task, steal ) )
+            this_thread::yield();
+        task( worker );
+
+        {
+            lock_guard< mutex > guard( lock );
+            running--;
+            if( steal )
+                stolen++;
+            if( queued == 0 && running == 0 )
+                done.notify_all();
+        }
+    }
+}
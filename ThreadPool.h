@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads with work stealing. Every worker has its
+// own queue of tasks: it runs them in the order of submission and, when the
+// queue is empty, steals the most recently submitted tasks of other workers.
+// Tasks receive the index of the worker running them. The optional
+// `initialize` is called by every worker once before it runs any task.
+class ThreadPool
+{
+public:
+    typedef std::function< void( unsigned worker ) > Task;
+
+    explicit ThreadPool( unsigned threads, Task initialize = Task() );
+    ~ThreadPool( void );
+
+    ThreadPool( const ThreadPool & ) = delete;
+    ThreadPool & operator=( const ThreadPool & ) = delete;
+
+    unsigned size( void ) const { return workers.size(); };
+
+    // add a task to the queues (round-robin)
+    void submit( Task task );
+    // block until all submitted tasks are finished
+    void wait( void );
+
+    // number of tasks taken from the queue of another worker
+    unsigned steals( void ) const { return stolen; };
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque< Task > tasks;
+    };
+
+    std::vector< std::unique_ptr< Queue > > queues;
+    std::vector< std::thread > workers;
+
+    // protects the counters and the stopping flag
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned queued = 0;
+    unsigned running = 0;
+    unsigned next = 0;
+    unsigned stolen = 0;
+    bool stopping = false;
+
+    bool pop( unsigned worker, Task & task, bool & steal );
+    void work( unsigned worker );
+};
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TimeSeries.h"
+
+using namespace std;
+
+static_assert( sizeof( TimeSeriesHeader ) == 72, "unexpected padding of TimeSeriesHeader" );
+static_assert( sizeof( TimeSeriesField ) == 48, "unexpected padding of TimeSeriesField" );
+static_assert( sizeof( TimeSeriesIndexEntry ) == 16, "unexpected padding of TimeSeriesIndexEntry" );
+
+namespace {
+
+uint64_t align( uint64_t offset )
+{
+    return ( offset + TimeSeries::alignment - 1 ) / TimeSeries::alignment * TimeSeries::alignment;
+}
+
+} // namespace
+
+TimeSeriesWriter::~TimeSeriesWriter( void )
+{
+    close();
+}
+
+bool TimeSeriesWriter::add_field( const string & name, TimeSeries::Location location, IndexType count, TimeSeries::Type type )
+{
+    TimeSeriesField field = {};
+    if( file.is_open() || name.size() >= sizeof( field.name ) || count < 0 ) {
+        cerr << "Invalid time series field " << name << "." << endl;
+        return false;
+    }
+    strncpy( field.name, name.c_str(), sizeof( field.name ) - 1 );
+    field.type = type;
+    field.location = location;
+    field.count = count;
+    field.offset = fields.empty() ? 0 : align( fields.back().offset + fields.back().count * TimeSeries::type_size( fields.back().type ) );
+    fields.push_back( field );
+    return true;
+}
+
+bool TimeSeriesWriter::open( const string & file_name, double width, double height, IndexType rows, IndexType cols )
+{
+    file.open( file_name.c_str(), ios::binary | ios::trunc );
+    if( ! file.is_open() ) {
+        cerr << "Unable to open the time series file " << file_name << "." << endl;
+        return false;
+    }
+
+    header = {};
+    copy_n( TimeSeries::magic, sizeof( header.magic ), header.magic );
+    header.version = TimeSeries::version;
+    header.num_fields = fields.size();
+    header.rows = rows;
+    header.cols = cols;
+    header.width = width;
+    header.height = height;
+    header.data_offset = align( sizeof( TimeSeriesHeader ) + fields.size() * sizeof( TimeSeriesField ) );
+    if( ! fields.empty() )
+        header.frame_bytes = align( fields.back().offset + fields.back().count * TimeSeries::type_size( fields.back().type ) );
+    index.clear();
+    frame.assign( header.frame_bytes, 0 );
+
+    // header (rewritten by close), field table and padding up to the first frame
+    vector< char > head( header.data_offset, 0 );
+    memcpy( head.data(), &header, sizeof( header ) );
+    if( ! fields.empty() )
+        memcpy( head.data() + sizeof( header ), fields.data(), fields.size() * sizeof( TimeSeriesField ) );
+    file.write( head.data(), head.size() );
+    return ! file.fail();
+}
+
+bool TimeSeriesWriter::append( double time, const vector< const Array* > & data )
+{
+    if( ! file.is_open() || data.size() != fields.size() )
+        return false;
+    for( size_t f = 0; f < fields.size(); f++ ) {
+        const TimeSeriesField & field = fields[ f ];
+        if( (uint64_t) data[ f ]->getSize() != field.count )
+            return false;
+        const RealType* values = data[ f ]->getData();
+        char* target = frame.data() + field.offset;
+        if( field.type == TimeSeries::FLOAT32 ) {
+            float* output = reinterpret_cast< float* >( target );
+            for( uint64_t i = 0; i < field.count; i++ )
+                output[ i ] = values[ i ];
+        }
+        else {
+            double* output = reinterpret_cast< double* >( target );
+            copy_n( values, field.count, output );
+        }
+    }
+
+    index.push_back( TimeSeriesIndexEntry{ time, header.data_offset + index.size() * header.frame_bytes } );
+    // an interrupted run leaves all complete frames in the file
+    file.write( frame.data(), frame.size() );
+    file.flush();
+    return ! file.fail();
+}
+
+bool TimeSeriesWriter::close( void )
+{
+    if( ! file.is_open() )
+        return true;
+    header.num_frames = index.size();
+    header.index_offset = header.data_offset + header.num_frames * header.frame_bytes;
+    file.write( reinterpret_cast< const char* >( index.data() ), index.size() * sizeof( TimeSeriesIndexEntry ) );
+    file.seekp( 0 );
+    file.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+    file.close();
+    return ! file.fail();
+}
+
+
+TimeSeriesReader::~TimeSeriesReader( void )
+{
+    close();
+}
+
+bool TimeSeriesReader::open( const string & file_name )
+{
+    close();
+    const int fd = ::open( file_name.c_str(), O_RDONLY );
+    if( fd < 0 ) {
+        cerr << "Unable to open the time series file " << file_name << "." << endl;
+        return false;
+    }
+    struct stat st;
+    void* mapping = MAP_FAILED;
+    if( fstat( fd, &st ) == 0 && st.st_size > 0 )
+        mapping = mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    // the mapping stays valid after closing the descriptor
+    ::close( fd );
+    if( mapping == MAP_FAILED ) {
+        cerr << "Unable to map the time series file " << file_name << "." << endl;
+        return false;
+    }
+    base = static_cast< const char* >( mapping );
+    size = st.st_size;
+
+    // validate the layout before anything is dereferenced
+    header = reinterpret_cast< const TimeSeriesHeader* >( base );
+    bool valid = size >= sizeof( TimeSeriesHeader )
+              && memcmp( header->magic, TimeSeries::magic, sizeof( TimeSeries::magic ) ) == 0
+              && header->version == TimeSeries::version
+              && header->data_offset >= sizeof( TimeSeriesHeader ) + header->num_fields * sizeof( TimeSeriesField )
+              && header->index_offset != 0
+              && header->index_offset == header->data_offset + header->num_frames * header->frame_bytes
+              && header->index_offset + header->num_frames * sizeof( TimeSeriesIndexEntry ) <= size;
+    if( valid ) {
+        fields = reinterpret_cast< const TimeSeriesField* >( base + sizeof( TimeSeriesHeader ) );
+        index = reinterpret_cast< const TimeSeriesIndexEntry* >( base + header->index_offset );
+        for( unsigned f = 0; f < header->num_fields; f++ )
+            valid &= fields[ f ].offset + fields[ f ].count * TimeSeries::type_size( fields[ f ].type ) <= header->frame_bytes;
+        for( unsigned i = 0; i < header->num_frames; i++ )
+            valid &= index[ i ].offset == header->data_offset + i * header->frame_bytes;
+    }
+    if( ! valid ) {
+        cerr << "The file " << file_name << " is not a complete time series." << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TimeSeriesReader::close( void )
+{
+    if( base )
+        munmap( const_cast< char* >( base ), size );
+    base = nullptr;
+    size = 0;
+    header = nullptr;
+    fields = nullptr;
+    index = nullptr;
+}
+
+int TimeSeriesReader::find_field( const string & name ) const
+{
+    for( unsigned f = 0; f < header->num_fields; f++ ) {
+        if( strncmp( fields[ f ].name, name.c_str(), sizeof( fields[ f ].name ) ) == 0 )
+            return f;
+    }
+    return -1;
+}
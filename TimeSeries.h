@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Array.h"
+
+// Binary container of a time series of snapshots in a single file (native
+// little-endian byte order):
+//
+//   header        TimeSeriesHeader: mesh geometry, frame layout, number of
+//                 frames and the position of the index
+//   field table   num_fields x TimeSeriesField: name, element type, mesh
+//                 entity (cells/edges), number of elements and the offset
+//                 within a frame
+//   frames        num_frames x frame_bytes from data_offset, the fields of a
+//                 frame are contiguous arrays aligned to 64 bytes
+//   index         num_frames x TimeSeriesIndexEntry (time and file offset
+//                 of the frame), written when the file is closed
+//
+// The frames have a fixed size, so a reader can map the file and use the
+// frames in place. index_offset is zero while the file is being written.
+
+struct TimeSeriesHeader
+{
+    char magic[ 8 ];
+    uint32_t version;
+    uint32_t num_fields;
+    int32_t rows;
+    int32_t cols;
+    double width;
+    double height;
+    uint64_t data_offset;
+    uint64_t frame_bytes;
+    uint64_t num_frames;
+    uint64_t index_offset;
+};
+
+struct TimeSeriesField
+{
+    char name[ 24 ];
+    uint32_t type;          // TimeSeries::Type
+    uint32_t location;      // TimeSeries::Location
+    uint64_t count;
+    uint64_t offset;        // from the beginning of a frame
+};
+
+struct TimeSeriesIndexEntry
+{
+    double time;
+    uint64_t offset;        // from the beginning of the file
+};
+
+namespace TimeSeries {
+    const char magic[ 8 ] = { 'U', 'M', 'F', 'S', 'N', 'A', 'P', '\0' };
+    const uint32_t version = 1;
+    const size_t alignment = 64;
+
+    enum Type : uint32_t { FLOAT64 = 0, FLOAT32 = 1 };
+    enum Location : uint32_t { CELLS = 0, EDGES = 1 };
+
+    inline size_t type_size( uint32_t type ) { return type == FLOAT32 ? 4 : 8; }
+}
+
+class TimeSeriesWriter
+{
+public:
+    TimeSeriesWriter( void ) = default;
+    ~TimeSeriesWriter( void );
+
+    TimeSeriesWriter( const TimeSeriesWriter & ) = delete;
+    TimeSeriesWriter & operator=( const TimeSeriesWriter & ) = delete;
+
+    // fields must be added before open(), the order defines the order of the
+    // arrays passed to append()
+    bool add_field( const std::string & name, TimeSeries::Location location, IndexType count,
+                    TimeSeries::Type type = TimeSeries::FLOAT64 );
+
+    bool open( const std::string & file_name, double width, double height, IndexType rows, IndexType cols );
+    bool is_open( void ) const { return file.is_open(); };
+
+    // one frame with the values of all fields (converted to the field type)
+    bool append( double time, const std::vector< const Array* > & data );
+
+    // write the index and the final header
+    bool close( void );
+
+private:
+    std::ofstream file;
+    TimeSeriesHeader header = {};
+    std::vector< TimeSeriesField > fields;
+    std::vector< TimeSeriesIndexEntry > index;
+    std::vector< char > frame;      // frame being written, including padding
+};
+
+// Read-only view of a closed time series file mapped into memory; the frame
+// data are used in place without copying.
+class TimeSeriesReader
+{
+public:
+    TimeSeriesReader( void ) = default;
+    ~TimeSeriesReader( void );
+
+    TimeSeriesReader( const TimeSeriesReader & ) = delete;
+    TimeSeriesReader & operator=( const TimeSeriesReader & ) = delete;
+
+    bool open( const std::string & file_name );
+    void close( void );
+
+    const TimeSeriesHeader & get_header( void ) const { return *header; };
+    unsigned num_frames( void ) const { return header->num_frames; };
+    unsigned num_fields( void ) const { return header->num_fields; };
+    const TimeSeriesField & get_field( unsigned i ) const { return fields[ i ]; };
+    // index of the field with given name, -1 if there is none
+    int find_field( const std::string & name ) const;
+
+    double time( unsigned frame ) const { return index[ frame ].time; };
+
+    // values of a field in a frame, nullptr if T does not match the field type
+    template< typename T >
+    const T* data( unsigned frame, unsigned field ) const
+    {
+        if( sizeof( T ) != TimeSeries::type_size( fields[ field ].type ) )
+            return nullptr;
+        return reinterpret_cast< const T* >( base + index[ frame ].offset + fields[ field ].offset );
+    }
+
+private:
+    const char* base = nullptr;
+    size_t size = 0;
+    const TimeSeriesHeader* header = nullptr;
+    const TimeSeriesField* fields = nullptr;
+    const TimeSeriesIndexEntry* index = nullptr;
+};
@@ -0,0 +1,135 @@
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Trace.h"
+
+using namespace std;
+
+namespace {
+
+struct Event
+{
+    const char* name;
+    Trace::Clock::time_point begin;
+    Trace::Clock::time_point end;
+};
+
+// events of one thread, only the owning thread appends to it
+struct ThreadBuffer
+{
+    unsigned tid;
+    vector< Event > events;
+};
+
+// The buffers outlive their threads. A finished thread returns its buffer to
+// the free list and the next new thread continues in it, so the workers of
+// successive solvers (e.g. in the ensemble mode) appear as a few stable
+// threads in the trace. The
+// registry is locked only when a thread records its first event and when it
+// exits.
+struct Registry
+{
+    mutex lock;
+    vector< unique_ptr< ThreadBuffer > > buffers;
+    vector< ThreadBuffer* > free;
+    Trace::Clock::time_point epoch;
+};
+
+Registry & registry( void )
+{
+    static Registry instance;
+    return instance;
+}
+
+struct LocalBuffer
+{
+    ThreadBuffer* buffer = nullptr;
+
+    ~LocalBuffer( void )
+    {
+        if( buffer != nullptr ) {
+            Registry & r = registry();
+            lock_guard< mutex > guard( r.lock );
+            r.free.push_back( buffer );
+        }
+    }
+};
+
+thread_local LocalBuffer local;
+
+ThreadBuffer & thread_buffer( void )
+{
+    if( local.buffer == nullptr ) {
+        Registry & r = registry();
+        lock_guard< mutex > guard( r.lock );
+        if( r.free.empty() ) {
+            r.buffers.emplace_back( new ThreadBuffer );
+            r.buffers.back()->tid = r.buffers.size();
+            local.buffer = r.buffers.back().get();
+        }
+        else {
+            local.buffer = r.free.back();
+            r.free.pop_back();
+        }
+    }
+    return *local.buffer;
+}
+
+} // namespace
+
+atomic< bool > Trace::active( false );
+
+void Trace::enable( void )
+{
+    registry().epoch = Clock::now();
+    active.store( true );
+}
+
+void Trace::attach( void )
+{
+    thread_buffer();
+}
+
+void Trace::record( const char* name, Clock::time_point begin, Clock::time_point end )
+{
+    thread_buffer().events.push_back( Event{ name, begin, end } );
+}
+
+bool Trace::write( const string & file_name )
+{
+    active.store( false );
+    ofstream file( file_name.c_str() );
+    if( file.fail() ) {
+        cerr << "Unable to open the trace file " << file_name << "." << endl;
+        return false;
+    }
+
+    Registry & r = registry();
+    lock_guard< mutex > guard( r.lock );
+    const int pid = getpid();
+    auto microseconds = [&r] ( Clock::time_point t ) {
+        return chrono::duration< double, micro >( t - r.epoch ).count();
+    };
+
+    // complete events ("X") carry both the begin and the duration
+    file << fixed << setprecision( 3 );
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for( const auto & buffer : r.buffers ) {
+        file << ( first ? "" : "," ) << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+             << ",\"tid\":" << buffer->tid << ",\"args\":{\"name\":\"thread " << buffer->tid << "\"}}";
+        first = false;
+        for( const Event & event : buffer->events ) {
+            file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+                 << ",\"ts\":" << microseconds( event.begin ) << ",\"dur\":" << microseconds( event.end ) - microseconds( event.begin ) << "}";
+        }
+    }
+    file << "\n]}\n";
+    return ! file.fail();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// Recorder of trace events for the Chrome trace viewer and Perfetto. When
+// enabled, every thread appends the begin and end times of its events to its
+// own buffer without locking; write() converts all buffers to a JSON file in
+// the Chrome trace event format. Event names must be string literals or
+// otherwise outlive the recorder.
+class Trace
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // start recording, timestamps are relative to this call
+    static void enable( void );
+    static bool enabled( void ) { return active.load( std::memory_order_relaxed ); };
+
+    // begin time of an event; a buffer is assigned to the thread here, so
+    // that a buffer taken over from a finished thread never gets events
+    // overlapping with those of its previous owner
+    static Clock::time_point now( void )
+    {
+        if( enabled() )
+            attach();
+        return Clock::now();
+    }
+
+    static void record( const char* name, Clock::time_point begin, Clock::time_point end );
+
+    // write the events of all threads; the threads must not record anymore
+    static bool write( const std::string & file_name );
+
+    // records an event from construction to destruction
+    class Scope
+    {
+    public:
+        explicit Scope( const char* name )
+            : name( name ), begin( now() )
+        {}
+
+        ~Scope( void )
+        {
+            if( enabled() )
+                record( name, begin, Clock::now() );
+        }
+
+        Scope( const Scope & ) = delete;
+        Scope & operator=( const Scope & ) = delete;
+
+    private:
+        const char* name;
+        const Clock::time_point begin;
+    };
+
+private:
+    static std::atomic< bool > active;
+    static void attach( void );
+};
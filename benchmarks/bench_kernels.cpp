@@ -0,0 +1,72 @@
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "CellKernels.h"
+#include "RectangularMesh.h"
+#include "harness.h"
+
+using namespace std;
+
+// benchmark all supported variants on a size x size mesh
+void bench_mesh( int size )
+{
+    RectangularMesh mesh;
+    mesh.setup( 10, 10, size, size );
+    const IndexType n = mesh.num_cells();
+
+    // per-cell arrays in the layout used by Solver
+    vector< IndexType > edges( 4 * n );
+    vector< RealType > weights( 4 * n );
+    vector< RealType > shift( n );
+    vector< RealType > trace( mesh.num_edges() );
+    vector< RealType > pressure( n );
+    for( IndexType cell = 0; cell < n; cell++ ) {
+        for( int i = 0; i < 4; i++ ) {
+            edges[ i * n + cell ] = mesh.edge_for_cell( cell, i );
+            weights[ i * n + cell ] = 0.2 + 0.01 * i;
+        }
+        shift[ cell ] = 1e3;
+    }
+    for( IndexType edge = 0; edge < mesh.num_edges(); edge++ )
+        trace[ edge ] = 1e5 + edge % 17;
+
+    const HarnessOptions options;
+    cout << endl << "mesh " << size << "x" << size << ", median of " << options.samples << " samples" << endl;
+    cout << setw( 10 ) << "isa" << setw( 18 ) << "kernel" << setw( 14 ) << "ns/cell" << setw( 10 ) << "speedup" << endl;
+
+    double reference[ 2 ] = { 0.0, 0.0 };
+    for( const char* isa : { "scalar", "avx2", "avx512" } ) {
+        const CellKernels* kernels = cell_kernels( isa );
+        if( kernels == nullptr ) {
+            cout << setw( 10 ) << isa << "  not supported" << endl;
+            continue;
+        }
+
+        // median time per cell
+        double times[ 2 ];
+        times[ 0 ] = measure( options, n, [&] () {
+            kernels->update_pressure( n, n, edges.data(), weights.data(), shift.data(), trace.data(), pressure.data() );
+        } ).median;
+        times[ 1 ] = measure( options, n, [&] () {
+            kernels->scale( n, 0.5, shift.data(), pressure.data() );
+        } ).median;
+
+        const char* names[ 2 ] = { "update_pressure", "scale" };
+        for( int k = 0; k < 2; k++ ) {
+            if( reference[ k ] == 0.0 )
+                reference[ k ] = times[ k ];
+            cout << setw( 10 ) << isa << setw( 18 ) << names[ k ]
+                 << setw( 14 ) << fixed << setprecision( 3 ) << times[ k ] * 1e9
+                 << setw( 10 ) << setprecision( 2 ) << reference[ k ] / times[ k ] << endl;
+        }
+    }
+}
+
+int main( void )
+{
+    // cache-resident and memory-bound problem sizes
+    bench_mesh( 64 );
+    bench_mesh( 512 );
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "simulation.h"
+
+using namespace std;
+
+// Mesh sequencing: the first half of the simulated interval is computed on
+// a coarsened mesh, the rest on the fine mesh. Compared with a cold start
+// on the fine mesh in wall-clock time and in the final pressure.
+
+const IndexType mesh_size = 32;
+const RealType time_step = 0.05;
+const RealType final_time = 10.0;
+const RealType coarse_time = 5.0;
+
+SimulationResult simulate( unsigned coarsening )
+{
+    SolverOptions options;
+    options.final_time = final_time;
+    options.snapshot_period = coarse_time;
+    options.coarsening = coarsening;
+    options.coarse_time = coarse_time;
+
+    stringstream description;
+    description << "coarsening " << coarsening;
+    return simulate( "bench_mesh_sequencing-output", mesh_size, time_step, options, description.str() );
+}
+
+int main( void )
+{
+    cout << "mesh " << mesh_size << "x" << mesh_size << ", time step " << time_step << ", final time " << final_time
+         << ", coarse stage until " << coarse_time << endl;
+    cout << setw( 12 ) << "coarsening" << setw( 12 ) << "time [s]" << setw( 10 ) << "speedup" << setw( 24 ) << "max rel. difference" << endl;
+
+    const SimulationResult cold = simulate( 1 );
+    if( cold.pressure.empty() )
+        return 1;
+    cout << setw( 12 ) << "cold start" << setw( 12 ) << fixed << setprecision( 3 ) << cold.seconds
+         << setw( 10 ) << setprecision( 2 ) << 1.0 << setw( 24 ) << "-" << endl;
+
+    for( unsigned coarsening : { 2, 4 } ) {
+        const SimulationResult warm = simulate( coarsening );
+        if( warm.pressure.empty() )
+            return 1;
+        cout << setw( 12 ) << coarsening << setw( 12 ) << setprecision( 3 ) << warm.seconds
+             << setw( 10 ) << setprecision( 2 ) << cold.seconds / warm.seconds
+             << setw( 24 ) << scientific << setprecision( 3 ) << max_relative_difference( warm, cold ) << fixed << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include "SparseMatrix.h"
+#include "Vector.h"
+#include "harness.h"
+
+using namespace std;
+
+// Cost of the element access primitives the solver is built on: the three
+// paths of SparseMatrix::setElement (overwrite, insertion, deletion),
+// SparseMatrix::getElement depending on the number of elements in the row,
+// the bounds-checked Array::operator[] compared with raw data access,
+// Array::setAllElements and Vector::norm. Times are per element.
+
+const IndexType matrix_rows = 1 << 14;
+const IndexType array_size = 1 << 16;      // fits in L2
+const unsigned batch_size = 256;           // elements changed or read by one call
+
+HarnessOptions options;
+string filter;
+
+template< typename Prepare, typename Batch >
+void run( const string & name, unsigned operations, Prepare prepare, Batch batch )
+{
+    if( name.find( filter ) == string::npos )
+        return;
+    print_result( name, measure( options, operations, prepare, batch ) );
+}
+
+template< typename Batch >
+void run( const string & name, unsigned operations, Batch batch )
+{
+    run( name, operations, [] () {}, batch );
+}
+
+// matrix_rows x matrix_rows matrix with `density` elements in every row at
+// the even columns 0, 2, ..., built row by row (the appending path)
+void build_matrix( SparseMatrix & matrix, IndexType density )
+{
+    matrix.setSize( matrix_rows, matrix_rows );
+    matrix.reserve( matrix_rows * ( density + 1 ) );
+    for( IndexType row = 0; row < matrix_rows; row++ )
+        for( IndexType k = 0; k < density; k++ )
+            matrix.setElement( row, 2 * k, 1.0 + k );
+}
+
+void bench_set_element( void )
+{
+    const IndexType density = 8;
+
+    SparseMatrix matrix;
+    run( "setElement append (build)", matrix_rows * density,
+         [&matrix] () { build_matrix( matrix, density ); } );
+
+    build_matrix( matrix, density );
+    // rows of the batch spread over the whole matrix
+    vector< IndexType > rows( batch_size );
+    for( unsigned i = 0; i < batch_size; i++ )
+        rows[ i ] = (IndexType) ( (long) i * matrix_rows / batch_size );
+
+    run( "setElement overwrite", batch_size,
+         [&matrix, &rows] () {
+             for( IndexType row : rows )
+                 matrix.setElement( row, density, 2.0 );
+         } );
+
+    // odd columns are not in the pattern: insertion shifts the tail of the
+    // CSR arrays, the deletion restores the matrix
+    auto insert = [&matrix, &rows] () {
+        for( IndexType row : rows )
+            matrix.setElement( row, density + 1, 3.0 );
+    };
+    auto remove = [&matrix, &rows] () {
+        for( IndexType row : rows )
+            matrix.setElement( row, density + 1, 0.0 );
+    };
+    run( "setElement insert", batch_size, remove, insert );
+    run( "setElement delete", batch_size, insert, remove );
+    remove();
+}
+
+void bench_get_element( void )
+{
+    // pseudo-random rows, columns present in the row
+    vector< IndexType > rows( batch_size ), columns( batch_size );
+    for( unsigned i = 0; i < batch_size; i++ )
+        rows[ i ] = ( i * 7919 ) % matrix_rows;
+
+    for( IndexType density : { 1, 4, 16, 64 } ) {
+        SparseMatrix matrix;
+        build_matrix( matrix, density );
+        for( unsigned i = 0; i < batch_size; i++ )
+            columns[ i ] = 2 * ( ( i * 31 ) % density );
+
+        stringstream name;
+        name << "getElement " << density << " per row";
+        run( name.str(), batch_size,
+             [&matrix, &rows, &columns] () {
+                 RealType sum = 0.0;
+                 for( unsigned i = 0; i < batch_size; i++ )
+                     sum += matrix.getElement( rows[ i ], columns[ i ] );
+                 do_not_optimize( sum );
+             } );
+    }
+}
+
+void bench_array( void )
+{
+    Vector v;
+    v.setSize( array_size );
+    v.setAllElements( 0.5 );
+
+    run( "Array::operator[] read", array_size,
+         [&v] () {
+             const Vector & cv = v;
+             RealType sum = 0.0;
+             for( IndexType i = 0; i < array_size; i++ )
+                 sum += cv[ i ];
+             do_not_optimize( sum );
+         } );
+    run( "Array::getElement read", array_size,
+         [&v] () {
+             RealType sum = 0.0;
+             for( IndexType i = 0; i < array_size; i++ )
+                 sum += v.getElement( i );
+             do_not_optimize( sum );
+         } );
+    run( "Array::getData read", array_size,
+         [&v] () {
+             const RealType* data = v.getData();
+             RealType sum = 0.0;
+             for( IndexType i = 0; i < array_size; i++ )
+                 sum += data[ i ];
+             do_not_optimize( sum );
+         } );
+    run( "Array::operator[] write", array_size,
+         [&v] () {
+             for( IndexType i = 0; i < array_size; i++ )
+                 v[ i ] = i;
+             do_not_optimize( v.getData() );
+         } );
+    run( "Array::getData write", array_size,
+         [&v] () {
+             RealType* data = v.getData();
+             for( IndexType i = 0; i < array_size; i++ )
+                 data[ i ] = i;
+             do_not_optimize( data );
+         } );
+    run( "Array::setAllElements", array_size,
+         [&v] () {
+             v.setAllElements( 0.5 );
+             do_not_optimize( v.getData() );
+         } );
+    run( "Vector::norm", array_size,
+         [&v] () {
+             RealType norm = v.norm();
+             do_not_optimize( norm );
+         } );
+}
+
+int main( int argc, char** argv )
+{
+    static struct option long_options[] = {
+        { "samples", required_argument, 0, 's' },
+        { "warmup",  required_argument, 0, 'w' },
+        { "filter",  required_argument, 0, 'f' },
+        { 0, 0, 0, 0 }
+    };
+    int c;
+    while( ( c = getopt_long( argc, argv, "", long_options, NULL ) ) != -1 ) {
+        bool valid = true;
+        switch( c ) {
+            case 's': options.samples = atoi( optarg ); valid = options.samples > 0; break;
+            case 'w': options.warmup = atoi( optarg ); break;
+            case 'f': filter = optarg; break;
+            default: valid = false;
+        }
+        if( ! valid ) {
+            cerr << "usage: " << argv[ 0 ] << " [--samples <int>] [--warmup <int>] [--filter <substring>]" << endl;
+            return 1;
+        }
+    }
+
+    cout << "sparse matrix " << matrix_rows << " rows, array " << array_size << " elements, "
+         << options.samples << " samples after " << options.warmup << " warm-up samples, time per element" << endl;
+    print_header();
+    bench_set_element();
+    bench_get_element();
+    bench_array();
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <malloc.h>
+
+#include "Solver.h"
+
+using namespace std;
+
+// Scaling of the solver and of its stages with the mesh size and the number
+// of threads. Every configuration runs a few time steps with a snapshot after
+// each step; the per-phase times come from the profiler of the solver. The
+// results are printed as a table together with the scaling exponents
+// (least-squares slope of log time against log unknowns) and written to CSV
+// and JSON files for tracking across versions.
+
+const RealType time_step = 0.05;
+
+struct Result
+{
+    IndexType size = 0;
+    unsigned threads = 0;
+    IndexType unknowns = 0;
+    unsigned steps = 0;
+    double seconds = 0.0;           // whole run
+    double phase_seconds[ Profiler::NUM_PHASES ] = {};
+    size_t memory = 0;              // peak RSS increase during the run in bytes
+};
+
+// value of a field in /proc/self/status in bytes
+size_t status_memory( const string & field )
+{
+    ifstream status( "/proc/self/status" );
+    string key;
+    while( status >> key ) {
+        if( key == field ) {
+            size_t value;
+            status >> value;
+            return value * 1024;
+        }
+        status.ignore( numeric_limits< streamsize >::max(), '\n' );
+    }
+    return 0;
+}
+
+// reset the peak RSS (VmHWM) of the process to the current RSS
+bool reset_peak_memory( void )
+{
+    ofstream clear_refs( "/proc/self/clear_refs" );
+    clear_refs << "5" << endl;
+    return ! clear_refs.fail();
+}
+
+bool simulate( IndexType size, unsigned threads, unsigned steps, Result & result )
+{
+    SolverOptions options;
+    options.final_time = steps * time_step;
+    options.snapshot_period = time_step;
+    options.threads = threads;
+    options.verbose = false;
+
+    // return the memory freed by the previous runs to the system, otherwise
+    // this run could reuse it without increasing RSS
+    malloc_trim( 0 );
+    const bool peak_reset = reset_peak_memory();
+    const size_t baseline = status_memory( "VmRSS:" );
+
+    Solver solver( "bench_scaling-output", size, size, time_step, 0, options );
+    auto start = chrono::steady_clock::now();
+    const bool status = solver.run();
+    auto stop = chrono::steady_clock::now();
+    if( ! status ) {
+        cerr << "Simulation failed (" << size << "x" << size << ", " << threads << " threads)." << endl;
+        return false;
+    }
+
+    result.size = size;
+    result.threads = threads;
+    result.unknowns = solver.get_mesh().num_edges();
+    result.steps = steps;
+    result.seconds = chrono::duration< double >( stop - start ).count();
+    for( int phase = 0; phase < Profiler::NUM_PHASES; phase++ )
+        result.phase_seconds[ phase ] = solver.get_profiler().total( (Profiler::Phase) phase );
+    // without the reset the peak of a previous larger run would hide this one
+    if( peak_reset )
+        result.memory = status_memory( "VmHWM:" ) - baseline;
+    else
+        result.memory = Solver::estimate_memory( size, size, options );
+    return true;
+}
+
+// least-squares slope of log( y ) against log( x ), NaN if undefined
+double scaling_exponent( const vector< double > & x, const vector< double > & y )
+{
+    double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    int n = 0;
+    for( size_t i = 0; i < x.size(); i++ ) {
+        if( x[ i ] <= 0.0 || y[ i ] <= 0.0 )
+            continue;
+        const double lx = log( x[ i ] );
+        const double ly = log( y[ i ] );
+        sx += lx;
+        sy += ly;
+        sxx += lx * lx;
+        sxy += lx * ly;
+        n++;
+    }
+    if( n < 2 || n * sxx - sx * sx == 0.0 )
+        return nan( "" );
+    return ( n * sxy - sx * sy ) / ( n * sxx - sx * sx );
+}
+
+// comma-separated list of positive integers
+bool parse_list( const char* text, vector< unsigned > & values )
+{
+    values.clear();
+    stringstream ss( text );
+    string item;
+    while( getline( ss, item, ',' ) ) {
+        const int value = atoi( item.c_str() );
+        if( value <= 0 )
+            return false;
+        values.push_back( value );
+    }
+    return ! values.empty();
+}
+
+// phases shown in the table
+const Profiler::Phase reported_phases[] = {
+    Profiler::ASSEMBLY, Profiler::SYMBOLIC, Profiler::NUMERIC, Profiler::SOLVE, Profiler::PRESSURE, Profiler::SNAPSHOT
+};
+
+int main( int argc, char** argv )
+{
+    vector< unsigned > sizes = { 32, 64, 128, 256 };
+    vector< unsigned > thread_counts = { 1, 2, 4 };
+    unsigned steps = 5;
+    string csv_file = "bench_scaling.csv";
+    string json_file = "bench_scaling.json";
+
+    static struct option long_options[] = {
+        { "sizes",   required_argument, 0, 's' },
+        { "threads", required_argument, 0, 'j' },
+        { "steps",   required_argument, 0, 'n' },
+        { "csv",     required_argument, 0, 'c' },
+        { "json",    required_argument, 0, 'o' },
+        { 0, 0, 0, 0 }
+    };
+    int c;
+    while( ( c = getopt_long( argc, argv, "", long_options, NULL ) ) != -1 ) {
+        bool valid = true;
+        switch( c ) {
+            case 's': valid = parse_list( optarg, sizes ); break;
+            case 'j': valid = parse_list( optarg, thread_counts ); break;
+            case 'n': steps = atoi( optarg ); valid = steps > 0; break;
+            case 'c': csv_file = optarg; break;
+            case 'o': json_file = optarg; break;
+            default: valid = false;
+        }
+        if( ! valid ) {
+            cerr << "usage: " << argv[ 0 ] << " [--sizes 32,64,...] [--threads 1,2,...] [--steps <int>] [--csv <file>] [--json <file>]" << endl;
+            return 1;
+        }
+    }
+
+    vector< Result > results;
+    cout << "time step " << time_step << ", " << steps << " steps with a snapshot after each" << endl;
+    cout << setw( 10 ) << "mesh" << setw( 8 ) << "threads" << setw( 10 ) << "unknowns";
+    for( Profiler::Phase phase : reported_phases )
+        cout << setw( 16 ) << Profiler::phase_name( phase );
+    cout << setw( 12 ) << "step [ms]" << setw( 14 ) << "ns/unknown" << setw( 14 ) << "B/unknown" << endl;
+    for( unsigned size : sizes ) {
+        for( unsigned threads : thread_counts ) {
+            Result result;
+            if( ! simulate( size, threads, steps, result ) )
+                return 1;
+            results.push_back( result );
+
+            stringstream mesh;
+            mesh << size << "x" << size;
+            cout << setw( 10 ) << mesh.str() << setw( 8 ) << threads << setw( 10 ) << result.unknowns
+                 << fixed << setprecision( 3 );
+            // milliseconds per step
+            for( Profiler::Phase phase : reported_phases )
+                cout << setw( 16 ) << 1e3 * result.phase_seconds[ phase ] / steps;
+            cout << setw( 12 ) << 1e3 * result.seconds / steps
+                 << setw( 14 ) << setprecision( 1 ) << 1e9 * result.seconds / steps / result.unknowns
+                 << setw( 14 ) << (double) result.memory / result.unknowns << endl;
+        }
+    }
+
+    // scaling exponents per thread count: time per step ~ unknowns^exponent
+    cout << "scaling exponents (time ~ unknowns^e):" << endl;
+    cout << setw( 18 ) << "threads";
+    for( Profiler::Phase phase : reported_phases )
+        cout << setw( 16 ) << Profiler::phase_name( phase );
+    cout << setw( 12 ) << "step" << setw( 14 ) << "memory" << endl;
+    vector< vector< double > > exponents;
+    for( unsigned threads : thread_counts ) {
+        vector< double > unknowns, step, memory;
+        vector< vector< double > > phases( sizeof( reported_phases ) / sizeof( reported_phases[ 0 ] ) );
+        for( const Result & result : results ) {
+            if( result.threads != threads )
+                continue;
+            unknowns.push_back( result.unknowns );
+            step.push_back( result.seconds );
+            memory.push_back( result.memory );
+            for( size_t p = 0; p < phases.size(); p++ )
+                phases[ p ].push_back( result.phase_seconds[ reported_phases[ p ] ] );
+        }
+        vector< double > e;
+        for( const auto & phase : phases )
+            e.push_back( scaling_exponent( unknowns, phase ) );
+        e.push_back( scaling_exponent( unknowns, step ) );
+        e.push_back( scaling_exponent( unknowns, memory ) );
+        exponents.push_back( e );
+
+        cout << setw( 18 ) << threads << setprecision( 2 );
+        for( size_t i = 0; i < e.size(); i++ )
+            cout << setw( i + 2 < e.size() ? 16 : ( i + 1 < e.size() ? 12 : 14 ) ) << e[ i ];
+        cout << endl;
+    }
+
+    // machine-readable output
+    ofstream csv( csv_file.c_str() );
+    csv << "size_x,size_y,threads,unknowns,steps,total_s";
+    for( int phase = 0; phase < Profiler::NUM_PHASES; phase++ )
+        csv << "," << Profiler::field_name( (Profiler::Phase) phase ) << "_s";
+    csv << ",step_s,s_per_unknown_step,memory_bytes,bytes_per_unknown" << endl;
+    csv << setprecision( 9 );
+    for( const Result & result : results ) {
+        csv << result.size << "," << result.size << "," << result.threads << "," << result.unknowns << ","
+            << result.steps << "," << result.seconds;
+        for( int phase = 0; phase < Profiler::NUM_PHASES; phase++ )
+            csv << "," << result.phase_seconds[ phase ];
+        csv << "," << result.seconds / result.steps << "," << result.seconds / result.steps / result.unknowns
+            << "," << result.memory << "," << (double) result.memory / result.unknowns << endl;
+    }
+
+    ofstream json( json_file.c_str() );
+    json << setprecision( 9 ) << "{\n  \"time_step\": " << time_step << ",\n  \"steps\": " << steps << ",\n  \"results\": [";
+    for( size_t i = 0; i < results.size(); i++ ) {
+        const Result & result = results[ i ];
+        json << ( i ? "," : "" ) << "\n    {\"size_x\": " << result.size << ", \"size_y\": " << result.size
+             << ", \"threads\": " << result.threads << ", \"unknowns\": " << result.unknowns
+             << ", \"total_s\": " << result.seconds << ", \"memory_bytes\": " << result.memory << ", \"phases_s\": {";
+        for( int phase = 0; phase < Profiler::NUM_PHASES; phase++ )
+            json << ( phase ? ", " : "" ) << "\"" << Profiler::field_name( (Profiler::Phase) phase ) << "\": " << result.phase_seconds[ phase ];
+        json << "}}";
+    }
+    json << "\n  ],\n  \"exponents\": [";
+    for( size_t t = 0; t < thread_counts.size(); t++ ) {
+        json << ( t ? "," : "" ) << "\n    {\"threads\": " << thread_counts[ t ];
+        const vector< double > & e = exponents[ t ];
+        for( size_t p = 0; p < e.size(); p++ ) {
+            const string name = ( p + 2 < e.size() ) ? Profiler::field_name( reported_phases[ p ] ) : ( p + 2 == e.size() ? "step" : "memory" );
+            // JSON has no NaN
+            json << ", \"" << name << "\": ";
+            if( std::isnan( e[ p ] ) )
+                json << "null";
+            else
+                json << e[ p ];
+        }
+        json << "}";
+    }
+    json << "\n  ]\n}\n";
+
+    if( csv.fail() || json.fail() ) {
+        cerr << "Failed to write " << csv_file << " or " << json_file << "." << endl;
+        return 1;
+    }
+    cout << "results written to " << csv_file << " and " << json_file << endl;
+    return 0;
+}
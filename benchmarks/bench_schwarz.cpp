@@ -0,0 +1,68 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "simulation.h"
+
+using namespace std;
+
+// Strong scaling of the domain decomposition solver of the edge system: the
+// same problem with 1, 2, 4, ..., 64 threads (one subdomain per thread)
+// compared with the direct UMFPACK solve on one thread. The mesh size can be
+// passed as the first argument.
+
+const RealType time_step = 0.05;
+const unsigned steps = 5;
+
+SimulationResult simulate( IndexType mesh_size, const string & linear_solver, unsigned threads )
+{
+    SolverOptions options;
+    options.final_time = steps * time_step;
+    options.snapshot_period = options.final_time;
+    options.threads = threads;
+    options.linear_solver = linear_solver;
+
+    stringstream description;
+    description << linear_solver << ", " << threads << " threads";
+    return simulate( "bench_schwarz-output", mesh_size, time_step, options, description.str() );
+}
+
+int main( int argc, char** argv )
+{
+    const IndexType mesh_size = ( argc > 1 ) ? atoi( argv[ 1 ] ) : 128;
+    if( mesh_size <= 0 ) {
+        cerr << "usage: " << argv[ 0 ] << " [mesh-size]" << endl;
+        return 1;
+    }
+
+    cout << "mesh " << mesh_size << "x" << mesh_size << ", " << steps << " steps, "
+         << thread::hardware_concurrency() << " hardware threads" << endl;
+
+    const SimulationResult direct = simulate( mesh_size, "umfpack", 1 );
+    if( direct.pressure.empty() )
+        return 1;
+    cout << setw( 10 ) << "threads" << setw( 12 ) << "time [s]" << setw( 10 ) << "speedup" << setw( 12 ) << "efficiency"
+         << setw( 16 ) << "GMRES it./step" << setw( 24 ) << "max rel. difference" << endl;
+    cout << setw( 10 ) << "umfpack" << setw( 12 ) << fixed << setprecision( 3 ) << direct.seconds << endl;
+
+    double serial = 0.0;
+    for( unsigned threads = 1; threads <= 64; threads *= 2 ) {
+        if( (IndexType) threads > mesh_size )
+            break;
+        const SimulationResult result = simulate( mesh_size, "schwarz", threads );
+        if( result.pressure.empty() )
+            return 1;
+        if( threads == 1 )
+            serial = result.seconds;
+        cout << setw( 10 ) << threads << setw( 12 ) << setprecision( 3 ) << result.seconds
+             << setw( 10 ) << setprecision( 2 ) << serial / result.seconds
+             << setw( 12 ) << serial / result.seconds / threads
+             << setw( 16 ) << setprecision( 1 ) << (double) result.krylov_iterations / steps
+             << setw( 24 ) << scientific << setprecision( 3 ) << max_relative_difference( result, direct ) << fixed << endl;
+    }
+
+    return 0;
+}
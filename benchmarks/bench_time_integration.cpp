@@ -0,0 +1,82 @@
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "simulation.h"
+
+using namespace std;
+
+// Convergence study of the time integrators: the pressure at the final time
+// is compared with a BDF2 solution computed with a much shorter time step.
+
+const IndexType mesh_size = 16;
+const RealType final_time = 1.0;
+
+SimulationResult simulate( const string & integrator, RealType tau )
+{
+    SolverOptions options;
+    options.integrator = integrator;
+    options.final_time = final_time;
+    options.snapshot_period = final_time;
+
+    stringstream description;
+    description << integrator << ", tau = " << tau;
+    return simulate( "bench_time_integration-output", mesh_size, tau, options, description.str() );
+}
+
+int main( void )
+{
+    const SimulationResult reference = simulate( "bdf2", 1.0 / 4096 );
+    if( reference.pressure.empty() )
+        return 1;
+
+    const char* integrators[ 2 ] = { "euler", "bdf2" };
+    vector< RealType > taus;
+    vector< RealType > errors[ 2 ];
+    vector< double > seconds[ 2 ];
+    for( RealType tau = 0.25; tau >= 1.0 / 256; tau /= 2 ) {
+        taus.push_back( tau );
+        for( int k = 0; k < 2; k++ ) {
+            const SimulationResult result = simulate( integrators[ k ], tau );
+            if( result.pressure.empty() )
+                return 1;
+            errors[ k ].push_back( max_relative_difference( result, reference ) );
+            seconds[ k ].push_back( result.seconds );
+        }
+    }
+
+    cout << "mesh " << mesh_size << "x" << mesh_size << ", final time " << final_time
+         << ", max relative error of pressure" << endl;
+    cout << setw( 10 ) << "tau" << setw( 8 ) << "steps";
+    for( int k = 0; k < 2; k++ )
+        cout << setw( 8 ) << integrators[ k ] << setw( 12 ) << "error" << setw( 8 ) << "order" << setw( 10 ) << "time [s]";
+    cout << endl;
+    for( size_t t = 0; t < taus.size(); t++ ) {
+        cout << setw( 10 ) << taus[ t ] << setw( 8 ) << lround( final_time / taus[ t ] );
+        for( int k = 0; k < 2; k++ ) {
+            cout << setw( 20 ) << scientific << setprecision( 3 ) << errors[ k ][ t ] << fixed << setprecision( 2 );
+            if( t > 0 )
+                cout << setw( 8 ) << log2( errors[ k ][ t - 1 ] / errors[ k ][ t ] );
+            else
+                cout << setw( 8 ) << "-";
+            cout << setw( 10 ) << setprecision( 3 ) << seconds[ k ][ t ];
+        }
+        cout << defaultfloat << endl;
+    }
+
+    // number of steps (linear solves) needed by BDF2 for the accuracy of the
+    // finest backward Euler run
+    const RealType target = errors[ 0 ].back();
+    for( size_t t = 0; t < taus.size(); t++ ) {
+        if( errors[ 1 ][ t ] <= target ) {
+            cout << "accuracy " << scientific << setprecision( 3 ) << target << defaultfloat
+                 << ": euler " << lround( final_time / taus.back() ) << " steps, bdf2 "
+                 << lround( final_time / taus[ t ] ) << " steps" << endl;
+            break;
+        }
+    }
+
+    return 0;
+}
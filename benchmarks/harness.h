@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Minimal in-tree microbenchmark harness: warm-up, repeated samples and
+// summary statistics of the time per operation.
+
+// keep `value` (and everything it depends on) from being optimized away
+template< typename T >
+inline void do_not_optimize( const T & value )
+{
+    asm volatile( "" : : "r,m"( value ) : "memory" );
+}
+
+// force pending stores to memory and reload cached values
+inline void clobber_memory( void )
+{
+    asm volatile( "" : : : "memory" );
+}
+
+// times per operation in seconds
+struct Statistics
+{
+    unsigned samples = 0;
+    double min = 0.0;
+    double median = 0.0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double max = 0.0;
+};
+
+struct HarnessOptions
+{
+    unsigned warmup = 3;        // untimed samples before the measurement
+    unsigned samples = 25;      // timed samples
+    double min_sample = 1e-3;   // the batch is repeated until a sample takes at least this long [s]
+};
+
+inline Statistics summarize( std::vector< double > times )
+{
+    Statistics stats;
+    stats.samples = times.size();
+    if( times.empty() )
+        return stats;
+    std::sort( times.begin(), times.end() );
+    stats.min = times.front();
+    stats.max = times.back();
+    stats.median = ( times.size() % 2 ) ? times[ times.size() / 2 ]
+                                        : 0.5 * ( times[ times.size() / 2 - 1 ] + times[ times.size() / 2 ] );
+    for( double t : times )
+        stats.mean += t;
+    stats.mean /= times.size();
+    for( double t : times )
+        stats.stddev += ( t - stats.mean ) * ( t - stats.mean );
+    if( times.size() > 1 )
+        stats.stddev = std::sqrt( stats.stddev / ( times.size() - 1 ) );
+    else
+        stats.stddev = 0.0;
+    return stats;
+}
+
+// Measure `batch`, which performs `operations` operations per call.
+// `prepare` runs before every call of `batch` and is not timed (e.g. to
+// restore the state changed by the batch). Fast batches are called several
+// times per sample so that the resolution of the clock does not matter.
+template< typename Prepare, typename Batch >
+Statistics measure( const HarnessOptions & options, unsigned operations, Prepare prepare, Batch batch )
+{
+    // time of `calls` calls of the batch
+    auto run = [&prepare, &batch] ( unsigned calls ) {
+        double elapsed = 0.0;
+        for( unsigned c = 0; c < calls; c++ ) {
+            prepare();
+            clobber_memory();
+            auto start = std::chrono::steady_clock::now();
+            batch();
+            clobber_memory();
+            elapsed += std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+        }
+        return elapsed;
+    };
+
+    unsigned calls = 1;
+    while( run( calls ) < options.min_sample && calls < ( 1u << 30 ) )
+        calls *= 2;
+
+    std::vector< double > times;
+    for( unsigned s = 0; s < options.warmup + options.samples; s++ ) {
+        const double elapsed = run( calls );
+        if( s >= options.warmup )
+            times.push_back( elapsed / calls / operations );
+    }
+    return summarize( times );
+}
+
+// `batch` without an untimed preparation
+template< typename Batch >
+Statistics measure( const HarnessOptions & options, unsigned operations, Batch batch )
+{
+    return measure( options, operations, [] () {}, batch );
+}
+
+inline void print_header( std::ostream & os = std::cout )
+{
+    os << std::left << std::setw( 40 ) << "benchmark" << std::right
+       << std::setw( 12 ) << "min [ns]" << std::setw( 12 ) << "median" << std::setw( 12 ) << "mean"
+       << std::setw( 10 ) << "rsd [%]" << std::setw( 12 ) << "max" << std::setw( 9 ) << "samples" << std::endl;
+}
+
+// one row of the table, times in nanoseconds per operation
+inline void print_result( const std::string & name, const Statistics & stats, std::ostream & os = std::cout )
+{
+    const double rsd = ( stats.mean > 0.0 ) ? 100 * stats.stddev / stats.mean : 0.0;
+    os << std::left << std::setw( 40 ) << name << std::right << std::fixed << std::setprecision( 2 )
+       << std::setw( 12 ) << 1e9 * stats.min << std::setw( 12 ) << 1e9 * stats.median << std::setw( 12 ) << 1e9 * stats.mean
+       << std::setw( 10 ) << std::setprecision( 1 ) << rsd
+       << std::setw( 12 ) << std::setprecision( 2 ) << 1e9 * stats.max << std::setw( 9 ) << stats.samples << std::endl;
+}
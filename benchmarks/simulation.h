@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Solver.h"
+
+// Helpers of the benchmarks which compare complete runs of the Solver:
+// one timed run with its final pressure and the difference of two runs.
+
+struct SimulationResult
+{
+    std::vector< RealType > pressure;   // empty when the run failed
+    double seconds = 0.0;               // wall-clock time of Solver::run
+    unsigned krylov_iterations = 0;     // GMRES iterations of the Schwarz solver
+};
+
+// run a size x size simulation with the time step `tau`, the output files
+// start with `prefix`; `description` identifies the run in the error message
+inline SimulationResult simulate( const std::string & prefix, IndexType size, RealType tau, SolverOptions options,
+                                  const std::string & description )
+{
+    options.verbose = false;
+
+    SimulationResult result;
+    Solver solver( prefix, size, size, tau, 0, options );
+    auto start = std::chrono::steady_clock::now();
+    const bool status = solver.run();
+    auto stop = std::chrono::steady_clock::now();
+    if( ! status ) {
+        std::cerr << "Simulation failed (" << description << ")." << std::endl;
+        return result;
+    }
+
+    const Vector & pressure = solver.get_pressure();
+    result.pressure.assign( pressure.getData(), pressure.getData() + pressure.getSize() );
+    result.seconds = std::chrono::duration< double >( stop - start ).count();
+    result.krylov_iterations = solver.get_schwarz().iterations;
+    return result;
+}
+
+// maximum relative difference of the pressures of two runs
+inline RealType max_relative_difference( const SimulationResult & result, const SimulationResult & reference )
+{
+    RealType difference = 0.0;
+    for( size_t i = 0; i < reference.pressure.size(); i++ )
+        difference = std::fmax( difference, std::fabs( result.pressure[ i ] - reference.pressure[ i ] ) / std::fabs( reference.pressure[ i ] ) );
+    return difference;
+}
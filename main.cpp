@@ -3,10 +3,15 @@
 #include <fstream>
 #include <sstream>
 #include <limits>
+#include <thread>
+#include <vector>
+#include <algorithm>
 
 #include <getopt.h>
 
 #include "Solver.h"
+#include "Ensemble.h"
+#include "Trace.h"
 
 using namespace std;
 
@@ -16,7 +21,14 @@ bool parse_options( int argc,
                     IndexType & size_x,
                     IndexType & size_y,
                     RealType & time_step,
-                    RealType & time_step_order )
+                    RealType & time_step_order,
+                    string & symbolic_cache_dir,
+                    SolverOptions & options,
+                    string & ensemble_file,
+                    unsigned & ensemble_threads,
+                    unsigned & memory_budget,
+                    bool & dry_run,
+                    string & trace_file )
 {
     int c;
     while (1) {
@@ -26,6 +38,38 @@ bool parse_options( int argc,
             { "size-y",          required_argument, 0, 'y' },
             { "time-step",       required_argument, 0, 't' },
             { "time-step-order", required_argument, 0, 'o' },
+            { "symbolic-cache",  required_argument, 0, 's' },
+            { "threads",         required_argument, 0, 'j' },
+            { "isa",             required_argument, 0, 'i' },
+            { "adaptive-tolerance", required_argument, 0, 'a' },
+            { "tau-min",         required_argument, 0, 'm' },
+            { "tau-max",         required_argument, 0, 'M' },
+            { "nonlinear",       required_argument, 0, 'n' },
+            { "nonlinear-tolerance", required_argument, 0, 'T' },
+            { "nonlinear-max-iterations", required_argument, 0, 'I' },
+            { "integrator",      required_argument, 0, 'g' },
+            { "steady-tolerance", required_argument, 0, 'e' },
+            { "steady-steps",    required_argument, 0, 'N' },
+            { "steady-solve",    no_argument,       0, 'S' },
+            { "fused",           no_argument,       0, 'f' },
+            { "coarsening",      required_argument, 0, 'c' },
+            { "coarse-time",     required_argument, 0, 'C' },
+            { "ensemble",        required_argument, 0, 'E' },
+            { "ensemble-threads", required_argument, 0, 'J' },
+            { "memory-budget",   required_argument, 0, 'B' },
+            { "linear-solver",   required_argument, 0, 'L' },
+            { "subdomains",      required_argument, 0, 'D' },
+            { "overlap",         required_argument, 0, 'O' },
+            { "krylov-tolerance", required_argument, 0, 'K' },
+            { "dry-run",         no_argument,       0, 'd' },
+            { "trace-file",      required_argument, 0, 'r' },
+            { "perf-counters",   no_argument,       0, 'P' },
+            { "progress",        required_argument, 0, 'v' },
+            { "progress-interval", required_argument, 0, 'R' },
+            { "telemetry-file",  required_argument, 0, 'l' },
+            { "snapshot-buffers", required_argument, 0, 'b' },
+            { "snapshot-format", required_argument, 0, 'F' },
+            { "snapshot-float32", no_argument,      0, 'q' },
             { 0, 0, 0, 0 }
         };
 
@@ -40,6 +84,7 @@ bool parse_options( int argc,
             {
                 stringstream ss(optarg);
                 ss >> output_prefix;
+                break;
             }
             case 'x':
             {
@@ -65,6 +110,193 @@ bool parse_options( int argc,
                 ss >> time_step_order;
                 break;
             }
+            case 's':
+            {
+                stringstream ss(optarg);
+                ss >> symbolic_cache_dir;
+                break;
+            }
+            case 'j':
+            {
+                stringstream ss(optarg);
+                ss >> options.threads;
+                break;
+            }
+            case 'i':
+            {
+                stringstream ss(optarg);
+                ss >> options.isa;
+                break;
+            }
+            case 'a':
+            {
+                stringstream ss(optarg);
+                ss >> options.adaptive_tolerance;
+                break;
+            }
+            case 'm':
+            {
+                stringstream ss(optarg);
+                ss >> options.tau_min;
+                break;
+            }
+            case 'M':
+            {
+                stringstream ss(optarg);
+                ss >> options.tau_max;
+                break;
+            }
+            case 'n':
+            {
+                stringstream ss(optarg);
+                ss >> options.nonlinear;
+                break;
+            }
+            case 'T':
+            {
+                stringstream ss(optarg);
+                ss >> options.nonlinear_tolerance;
+                break;
+            }
+            case 'I':
+            {
+                stringstream ss(optarg);
+                ss >> options.nonlinear_max_iterations;
+                break;
+            }
+            case 'g':
+            {
+                stringstream ss(optarg);
+                ss >> options.integrator;
+                break;
+            }
+            case 'e':
+            {
+                stringstream ss(optarg);
+                ss >> options.steady_tolerance;
+                break;
+            }
+            case 'N':
+            {
+                stringstream ss(optarg);
+                ss >> options.steady_steps;
+                break;
+            }
+            case 'S':
+            {
+                options.steady_solve = true;
+                break;
+            }
+            case 'f':
+            {
+                options.fused = true;
+                break;
+            }
+            case 'c':
+            {
+                stringstream ss(optarg);
+                ss >> options.coarsening;
+                break;
+            }
+            case 'C':
+            {
+                stringstream ss(optarg);
+                ss >> options.coarse_time;
+                break;
+            }
+            case 'E':
+            {
+                stringstream ss(optarg);
+                ss >> ensemble_file;
+                break;
+            }
+            case 'J':
+            {
+                stringstream ss(optarg);
+                ss >> ensemble_threads;
+                break;
+            }
+            case 'B':
+            {
+                stringstream ss(optarg);
+                ss >> memory_budget;
+                break;
+            }
+            case 'd':
+            {
+                dry_run = true;
+                break;
+            }
+            case 'r':
+            {
+                stringstream ss(optarg);
+                ss >> trace_file;
+                break;
+            }
+            case 'P':
+            {
+                options.perf_counters = true;
+                break;
+            }
+            case 'L':
+            {
+                stringstream ss(optarg);
+                ss >> options.linear_solver;
+                break;
+            }
+            case 'D':
+            {
+                stringstream ss(optarg);
+                ss >> options.subdomains;
+                break;
+            }
+            case 'O':
+            {
+                stringstream ss(optarg);
+                ss >> options.overlap;
+                break;
+            }
+            case 'K':
+            {
+                stringstream ss(optarg);
+                ss >> options.krylov_tolerance;
+                break;
+            }
+            case 'v':
+            {
+                stringstream ss(optarg);
+                ss >> options.progress;
+                break;
+            }
+            case 'R':
+            {
+                stringstream ss(optarg);
+                ss >> options.progress_interval;
+                break;
+            }
+            case 'l':
+            {
+                stringstream ss(optarg);
+                ss >> options.telemetry_file;
+                break;
+            }
+            case 'b':
+            {
+                stringstream ss(optarg);
+                ss >> options.snapshot_buffers;
+                break;
+            }
+            case 'F':
+            {
+                stringstream ss(optarg);
+                ss >> options.snapshot_format;
+                break;
+            }
+            case 'q':
+            {
+                options.snapshot_float32 = true;
+                break;
+            }
             default:
             {
                 cerr << "parsing error";
@@ -77,6 +309,42 @@ bool parse_options( int argc,
         cerr << "output-prefix must be non-empty string" << endl;
         return false;
     }
+    if( options.tau_min < 0.0 || options.tau_max < 0.0 || ( options.tau_max > 0.0 && options.tau_min > options.tau_max ) ) {
+        cerr << "tau-min and tau-max must be non-negative and tau-min <= tau-max" << endl;
+        return false;
+    }
+    if( options.nonlinear_tolerance <= 0.0 || options.nonlinear_max_iterations < 1 ) {
+        cerr << "nonlinear-tolerance and nonlinear-max-iterations must be positive" << endl;
+        return false;
+    }
+    if( options.coarsening < 1 || options.coarse_time < 0.0 ) {
+        cerr << "coarsening must be positive integer and coarse-time non-negative" << endl;
+        return false;
+    }
+    if( options.krylov_tolerance <= 0.0 ) {
+        cerr << "krylov-tolerance must be positive" << endl;
+        return false;
+    }
+    if( options.progress > Telemetry::STEPS || options.progress_interval < 0.0 ) {
+        cerr << "progress must be 0, 1 or 2 and progress-interval non-negative" << endl;
+        return false;
+    }
+    if( options.steady_steps < 1 ) {
+        cerr << "steady-steps must be positive integer" << endl;
+        return false;
+    }
+    if( options.threads < 1 ) {
+        cerr << "threads must be positive integer" << endl;
+        return false;
+    }
+    // mesh and time step are given per scenario in the ensemble mode
+    if( ensemble_file != "" ) {
+        if( ensemble_threads < 1 ) {
+            cerr << "ensemble-threads must be positive integer" << endl;
+            return false;
+        }
+        return true;
+    }
     if( size_x <= 0 ) {
         cerr << "size-x must be positive integer" << endl;
         return false;
@@ -127,9 +395,18 @@ int main( int argc, char** argv )
     IndexType size_y = 0;
     RealType time_step = 0.0;
     RealType time_step_order = 0;
+    string symbolic_cache_dir;
+    SolverOptions options;
+    string ensemble_file;
+    unsigned ensemble_threads = max( 1u, thread::hardware_concurrency() );
+    unsigned memory_budget = 0;
+    bool dry_run = false;
+    string trace_file;
 
     status &= parse_options( argc, argv,
-                             output_prefix, size_x, size_y, time_step, time_step_order );
+                             output_prefix, size_x, size_y, time_step, time_step_order,
+                             symbolic_cache_dir, options,
+                             ensemble_file, ensemble_threads, memory_budget, dry_run, trace_file );
     if( ! status ) {
         cerr << endl;
         cerr << "Usage: " << argv[ 0 ] << " options..." << endl;
@@ -139,6 +416,38 @@ int main( int argc, char** argv )
         cerr << "    --size-y <int>             mesh size in direction y (required)" << endl;
         cerr << "    --time-step <double>       initial time step (required)" << endl;
         cerr << "    --time-step-order <int>    time step is set to: time-step * pow( space-step, time-step-order ); default value is 0" << endl;
+        cerr << "    --symbolic-cache <dir>     directory for caching symbolic factorizations between runs" << endl;
+        cerr << "    --threads <int>            number of threads used for the assembly; default value is 1" << endl;
+        cerr << "    --isa <string>             instruction set of the cell kernels: scalar, avx2, avx512; detected by default" << endl;
+        cerr << "    --adaptive-tolerance <double>  enables adaptive time stepping with given relative tolerance of pressure" << endl;
+        cerr << "    --tau-min <double>         lower bound of the adaptive time step" << endl;
+        cerr << "    --tau-max <double>         upper bound of the adaptive time step" << endl;
+        cerr << "    --nonlinear <string>       nonlinear iteration per time step: none (lagged coefficients), picard, newton; default is none" << endl;
+        cerr << "    --nonlinear-tolerance <double>  relative change of pressure for convergence of the nonlinear iteration; default 1e-8" << endl;
+        cerr << "    --nonlinear-max-iterations <int>  maximum number of nonlinear iterations per time step; default 20" << endl;
+        cerr << "    --integrator <string>      time integrator: euler, bdf2; default is euler" << endl;
+        cerr << "    --steady-tolerance <double>  stop when the relative rate of change of pressure is below the tolerance" << endl;
+        cerr << "    --steady-steps <int>       number of consecutive steps below steady-tolerance; default 3" << endl;
+        cerr << "    --steady-solve             finish a steady run with a direct solve of the steady problem" << endl;
+        cerr << "    --fused                    single fused sweep over cells per step (backward Euler, fixed steps, no nonlinear iteration)" << endl;
+        cerr << "    --coarsening <int>         coarsening factor of the mesh for the initial stage (mesh sequencing); default 1 (disabled)" << endl;
+        cerr << "    --coarse-time <double>     length of the initial stage on the coarse mesh, rounded up to whole snapshot periods" << endl;
+        cerr << "    --ensemble <file>          run the scenarios from the file concurrently instead of a single simulation" << endl;
+        cerr << "    --ensemble-threads <int>   number of concurrently running scenarios; default is the number of CPUs" << endl;
+        cerr << "    --memory-budget <int>      per-thread memory budget of the ensemble in MiB; unlimited by default" << endl;
+        cerr << "    --linear-solver <string>   solver of the edge system: umfpack (direct), schwarz (GMRES with additive Schwarz); default umfpack" << endl;
+        cerr << "    --subdomains <int>         number of subdomains (strips of cell rows) of the schwarz solver; default is the number of threads" << endl;
+        cerr << "    --overlap <int>            overlap of the subdomains in rows of cells; default 1" << endl;
+        cerr << "    --krylov-tolerance <double>  relative residual tolerance of the schwarz solver; default 1e-10" << endl;
+        cerr << "    --dry-run                  only predict the peak memory and the time per step; solves a few steps of two small calibration problems, no full-size state is allocated" << endl;
+        cerr << "    --trace-file <file>        record the solver phases of all threads as Chrome trace JSON (chrome://tracing, Perfetto)" << endl;
+        cerr << "    --perf-counters            count cycles, instructions, cache misses, task clock and page faults per phase" << endl;
+        cerr << "    --progress <int>           per-step progress lines: 0 none, 1 rate-limited, 2 every step with phase times; default 1" << endl;
+        cerr << "    --progress-interval <double>  minimum interval between progress lines in seconds; default 1" << endl;
+        cerr << "    --telemetry-file <file>    write a JSON line with the times and solver statistics of every time step" << endl;
+        cerr << "    --snapshot-buffers <int>   copies of pressure for saving snapshots on a background thread, 0 saves synchronously; default 2" << endl;
+        cerr << "    --snapshot-format <string> text (one file per snapshot) or binary (all snapshots in <output-prefix>.snap); default is text" << endl;
+        cerr << "    --snapshot-float32         store binary snapshots in single precision" << endl;
         return EXIT_FAILURE;
     }
 
@@ -148,9 +457,41 @@ int main( int argc, char** argv )
     cout << "  size-y = " << size_y << endl;
     cout << "  time-step = " << time_step << endl;
     cout << "  time-step-order = " << time_step_order << endl;
+    cout << "  symbolic-cache = " << symbolic_cache_dir << endl;
+    cout << "  threads = " << options.threads << endl;
+    cout << "  adaptive-tolerance = " << options.adaptive_tolerance << endl;
+    cout << "  nonlinear = " << options.nonlinear << endl;
+    cout << "  integrator = " << options.integrator << endl;
+    cout << "  steady-tolerance = " << options.steady_tolerance << endl;
+    cout << "  linear-solver = " << options.linear_solver << endl;
+
+    SparseMatrix::set_symbolic_cache_dir( symbolic_cache_dir );
+    if( trace_file != "" )
+        Trace::enable();
 
-    Solver s( output_prefix, size_x, size_y, time_step, time_step_order );
+    if( ensemble_file != "" ) {
+        vector< Scenario > scenarios;
+        status &= load_scenarios( ensemble_file, options, scenarios );
+        if( status ) {
+            cout << "  ensemble = " << ensemble_file << " (" << scenarios.size() << " scenarios)" << endl;
+            status &= run_ensemble( scenarios, output_prefix, ensemble_threads, (size_t) memory_budget * 1024 * 1024 );
+        }
+        if( trace_file != "" )
+            status &= Trace::write( trace_file );
+        status &= report_peak_memory();
+        return !status;
+    }
+
+    Solver s( output_prefix, size_x, size_y, time_step, time_step_order, options );
+    if( dry_run ) {
+        status &= s.dry_run();
+        // peak memory of the dry run itself
+        status &= report_peak_memory();
+        return !status;
+    }
     status &= s.run();
+    if( trace_file != "" )
+        status &= Trace::write( trace_file );
 
     // print peak memory usage
     status &= report_peak_memory();
@@ -2,6 +2,8 @@
 
 import os.path
 import glob
+import struct
+import sys
 
 import matplotlib.pyplot as plt
 from matplotlib.widgets import Button
@@ -9,22 +11,62 @@ from mpl_toolkits.axes_grid1 import make_axes_locatable
 import numpy as np
 from scipy import interpolate
 
-width = 10
-height = 10
-cols = 100
-rows = 100
-filenames = sorted( glob.glob( "out/pressure-%dx%d-*.dat" % (rows, cols) ) )
-
-def load_values( fname ):
+# binary time series written with --snapshot-format binary (see TimeSeries.h)
+header_format = "<8sIIiiddQQQQ"
+field_format = "<24sIIQQ"
+index_format = "<dQ"
+field_types = { 0: "<f8", 1: "<f4" }
+
+def open_series( fname ):
+    # map the frames of the file as a structured array, nothing is read
+    # until a frame is accessed
+    with open( fname, "rb" ) as f:
+        header = f.read( struct.calcsize( header_format ) )
+        magic, version, num_fields, rows, cols, width, height, data_offset, frame_bytes, num_frames, index_offset = \
+            struct.unpack( header_format, header )
+        if magic != b"UMFSNAP\0" or version != 1 or index_offset == 0:
+            sys.exit( "%s is not a complete time series" % fname )
+        names, formats, offsets = [], [], []
+        for i in range( num_fields ):
+            name, type, location, count, offset = \
+                struct.unpack( field_format, f.read( struct.calcsize( field_format ) ) )
+            names.append( name.rstrip( b"\0" ).decode() )
+            formats.append( (field_types[ type ], (count,)) )
+            offsets.append( offset )
+    dtype = np.dtype( { "names": names, "formats": formats, "offsets": offsets, "itemsize": frame_bytes } )
+    frames = np.memmap( fname, dtype=dtype, mode="r", offset=data_offset, shape=(num_frames,) )
+    index = np.memmap( fname, dtype=[ ("time", "<f8"), ("offset", "<u8") ], mode="r",
+                       offset=index_offset, shape=(num_frames,) )
+    return width, height, rows, cols, frames, index["time"]
+
+if len( sys.argv ) > 1 and sys.argv[ 1 ].endswith( ".snap" ):
+    series = sys.argv[ 1 ]
+    width, height, rows, cols, frames, times = open_series( series )
+    prefix = os.path.splitext( series )[ 0 ]
+    filenames = [ "%s-%05d.dat" % (prefix, i) for i in range( len( frames ) ) ]
+    titles = [ "%s, t = %g" % (series, t) for t in times ]
+else:
+    width = 10
+    height = 10
+    cols = 100
+    rows = 100
+    frames = None
+    filenames = sorted( glob.glob( "out/pressure-%dx%d-*.dat" % (rows, cols) ) )
+    titles = filenames
+
+def load_values( num ):
     # load vector, reshape to matrix form
-    values = np.loadtxt( fname, usecols=(1,) )
+    if frames is not None:
+        values = frames[ num ][ "pressure" ]
+    else:
+        values = np.loadtxt( filenames[ num ], usecols=(1,) )
     values = np.reshape( values, (rows, cols) )
     return values
 
-def plot_mesh( fig, ax, fname ):
-    values = load_values( fname )
+def plot_mesh( fig, ax, num ):
+    values = load_values( num )
     aspect = (height/rows)/(width/cols)
-    fig.suptitle( fname, fontsize=14 )
+    fig.suptitle( titles[ num ], fontsize=14 )
 
     # plot mesh values
     img = ax.imshow( values,
@@ -46,8 +88,8 @@ def plot_mesh( fig, ax, fname ):
 
 # update the plot to show data from num-th file
 def update_plot( num ):
-    fig.suptitle( filenames[ num ], fontsize=14 )
-    values = load_values( filenames[ num ] )
+    fig.suptitle( titles[ num ], fontsize=14 )
+    values = load_values( num )
 
     # update mesh values
     img.set_data( values )
@@ -76,17 +118,17 @@ class Index:
 
 
 # save plots as png files
-for filename in filenames:
+for num, filename in enumerate( filenames ):
     out = os.path.splitext(filename)[0] + ".png"
     print( "Plotting %s..." % out )
     fig, ax = plt.subplots( 1, 1 )
-    plot_mesh( fig, ax, filename )
+    plot_mesh( fig, ax, num )
     fig.savefig( out )
     plt.close()
 
 # "interactive" output
 #fig, ax = plt.subplots( 1, 1 )
-#img, colorbar = plot_mesh( fig, ax, filenames[ 0 ] )
+#img, colorbar = plot_mesh( fig, ax, 0 )
 
 #callback = Index( len( filenames ), update_plot )
 #axprev = plt.axes( [0.40, 0.05, 0.1, 0.075] )
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Memory.h"
+#include "ThreadPool.h"
+
+// Call func( begin, end ) on contiguous chunks of the range [0, size), one
+// per worker of the pool and one for the calling thread, and wait for all of
+// them. The calling thread processes the first chunk itself; without a pool
+// the whole range is processed serially. The pool must not be shared with
+// other users while the call is in progress. The workers account their
+// allocations to the memory phase of the calling thread.
+template< typename Function >
+void parallel_for( ThreadPool* pool, int size, const Function & func )
+{
+    unsigned threads = ( pool != nullptr ) ? pool->size() + 1 : 1;
+    if( threads < 2 || size < 2 ) {
+        func( 0, size );
+        return;
+    }
+    if( (unsigned) size < threads )
+        threads = size;
+
+    const int phase = Memory::get_phase();
+    for( unsigned t = 1; t < threads; t++ ) {
+        const int begin = (long) size * t / threads;
+        const int end = (long) size * (t + 1) / threads;
+        pool->submit( [&func, begin, end, phase] ( unsigned ) {
+            const int previous = Memory::set_phase( phase );
+            func( begin, end );
+            Memory::set_phase( previous );
+        } );
+    }
+    func( 0, (long) size / threads );
+    pool->wait();
+}
+
@@ -0,0 +1,71 @@
+#include <vector>
+
+#include "test_kernels.h"
+#include "RectangularMesh.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_kernels );
+
+
+void test_kernels::test_update_pressure( void )
+{
+    // 5x7 mesh: rows are not multiples of the vector width
+    RectangularMesh mesh;
+    mesh.setup( 1, 1, 5, 7 );
+    const IndexType n = mesh.num_cells();
+
+    vector< IndexType > edges( 4 * n );
+    vector< RealType > weights( 4 * n );
+    vector< RealType > shift( n );
+    vector< RealType > trace( mesh.num_edges() );
+    for( IndexType cell = 0; cell < n; cell++ ) {
+        for( int i = 0; i < 4; i++ ) {
+            edges[ i * n + cell ] = mesh.edge_for_cell( cell, i );
+            weights[ i * n + cell ] = 0.1 * ( i + 1 ) + 1e-3 * cell;
+        }
+        shift[ cell ] = 1.0 / ( cell + 1 );
+    }
+    for( IndexType edge = 0; edge < mesh.num_edges(); edge++ )
+        trace[ edge ] = 1e5 + 3.7 * edge;
+
+    const CellKernels* scalar = cell_kernels( "scalar" );
+    CPPUNIT_ASSERT( scalar != nullptr );
+    vector< RealType > expected( n );
+    scalar->update_pressure( n, n, edges.data(), weights.data(), shift.data(), trace.data(), expected.data() );
+    for( IndexType cell = 0; cell < n; cell++ ) {
+        RealType p = shift[ cell ];
+        for( int i = 0; i < 4; i++ )
+            p += weights[ i * n + cell ] * trace[ edges[ i * n + cell ] ];
+        CPPUNIT_ASSERT_EQUAL( p, expected[ cell ] );
+    }
+
+    // all supported variants must give bitwise identical results
+    for( const char* isa : { "avx2", "avx512" } ) {
+        const CellKernels* kernels = cell_kernels( isa );
+        if( kernels == nullptr )
+            continue;
+        vector< RealType > pressure( n );
+        kernels->update_pressure( n, n, edges.data(), weights.data(), shift.data(), trace.data(), pressure.data() );
+        for( IndexType cell = 0; cell < n; cell++ )
+            CPPUNIT_ASSERT_EQUAL( expected[ cell ], pressure[ cell ] );
+    }
+}
+
+void test_kernels::test_scale( void )
+{
+    const IndexType n = 19;
+    vector< RealType > x( n );
+    for( IndexType i = 0; i < n; i++ )
+        x[ i ] = 0.3 * i;
+
+    for( const char* isa : { "scalar", "avx2", "avx512" } ) {
+        const CellKernels* kernels = cell_kernels( isa );
+        if( kernels == nullptr )
+            continue;
+        vector< RealType > y( n );
+        kernels->scale( n, 1.5, x.data(), y.data() );
+        for( IndexType i = 0; i < n; i++ )
+            CPPUNIT_ASSERT_EQUAL( 1.5 * x[ i ], y[ i ] );
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "CellKernels.h"
+
+using namespace CPPUNIT_NS;
+
+class test_kernels
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_kernels );
+    CPPUNIT_TEST( test_update_pressure );
+    CPPUNIT_TEST( test_scale );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_update_pressure( void );
+    void test_scale( void );
+};
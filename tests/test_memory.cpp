@@ -0,0 +1,101 @@
+#include <thread>
+
+#include "test_memory.h"
+#include "parallel.h"
+#include "SparseMatrix.h"
+#include "Vector.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_memory );
+
+
+void test_memory::test_array( void )
+{
+    const size_t before = Memory::live( Memory::VECTORS );
+    {
+        Vector v;
+        v.setSize( 1000 );
+        CPPUNIT_ASSERT_EQUAL( before + 1000 * sizeof( RealType ), Memory::live( Memory::VECTORS ) );
+        v.setSize( 10 );
+        CPPUNIT_ASSERT_EQUAL( before + 10 * sizeof( RealType ), Memory::live( Memory::VECTORS ) );
+        CPPUNIT_ASSERT( Memory::peak( Memory::VECTORS ) >= before + 1000 * sizeof( RealType ) );
+    }
+    CPPUNIT_ASSERT_EQUAL( before, Memory::live( Memory::VECTORS ) );
+}
+
+void test_memory::test_sparse_matrix( void )
+{
+    const size_t before = Memory::live( Memory::CSR );
+    const size_t numeric_before = Memory::live( Memory::UMFPACK_NUMERIC );
+    {
+        SparseMatrix matrix;
+        matrix.setSize( 3, 3 );
+        matrix.reserve( 100 );
+        CPPUNIT_ASSERT_EQUAL( before + matrix.memory_usage(), Memory::live( Memory::CSR ) );
+        for( int i = 0; i < 3; i++ )
+            matrix.setElement( i, i, 2.0 );
+        matrix.setElement( 0, 2, 1.0 );
+        CPPUNIT_ASSERT_EQUAL( before + matrix.memory_usage(), Memory::live( Memory::CSR ) );
+
+        Vector x, rhs;
+        x.setSize( 3 );
+        rhs.setSize( 3 );
+        rhs.setAllElements( 1.0 );
+        CPPUNIT_ASSERT( matrix.linear_solve( x, rhs ) );
+        CPPUNIT_ASSERT( Memory::live( Memory::UMFPACK_NUMERIC ) > numeric_before );
+        CPPUNIT_ASSERT( Memory::live( Memory::UMFPACK_SYMBOLIC ) > 0 );
+        // new values invalidate the numeric factorization
+        matrix.resetValues();
+        CPPUNIT_ASSERT_EQUAL( numeric_before, Memory::live( Memory::UMFPACK_NUMERIC ) );
+    }
+    CPPUNIT_ASSERT_EQUAL( before, Memory::live( Memory::CSR ) );
+}
+
+void test_memory::test_phases( void )
+{
+    const int phase = Memory::MAX_PHASES - 1;
+    CPPUNIT_ASSERT( ! Memory::phase_entered( phase ) );
+
+    const int previous = Memory::set_phase( phase );
+    const size_t held = Memory::live( Memory::VECTORS );
+    {
+        Vector v;
+        v.setSize( 4096 );
+    }
+    CPPUNIT_ASSERT_EQUAL( phase, Memory::set_phase( previous ) );
+
+    CPPUNIT_ASSERT( Memory::phase_entered( phase ) );
+    CPPUNIT_ASSERT_EQUAL( held + 4096 * sizeof( RealType ), Memory::phase_peak( phase, Memory::VECTORS ) );
+    CPPUNIT_ASSERT( Memory::phase_peak( phase, Memory::NUM_TAGS ) >= held + 4096 * sizeof( RealType ) );
+    // allocations outside of the phase do not change its peak
+    Vector w;
+    w.setSize( 8192 );
+    CPPUNIT_ASSERT_EQUAL( held + 4096 * sizeof( RealType ), Memory::phase_peak( phase, Memory::VECTORS ) );
+}
+
+void test_memory::test_thread_phases( void )
+{
+    const int phase = Memory::MAX_PHASES - 2;
+    const int previous = Memory::set_phase( phase );
+
+    // another thread (e.g. another solver of an ensemble) sets its own phase
+    int other_phase = 0;
+    std::thread other( [&other_phase] () {
+        other_phase = Memory::get_phase();
+        Memory::set_phase( 0 );
+    } );
+    other.join();
+    CPPUNIT_ASSERT_EQUAL( -1, other_phase );
+    CPPUNIT_ASSERT_EQUAL( phase, Memory::get_phase() );
+
+    // the workers of parallel_for take over the phase of the caller
+    ThreadPool pool( 2 );
+    std::vector< int > phases( 3, -1 );
+    parallel_for( &pool, phases.size(), [&phases] ( int begin, int end ) {
+        for( int i = begin; i < end; i++ )
+            phases[ i ] = Memory::get_phase();
+    } );
+    for( int p : phases )
+        CPPUNIT_ASSERT_EQUAL( phase, p );
+
+    CPPUNIT_ASSERT_EQUAL( phase, Memory::set_phase( previous ) );
+}
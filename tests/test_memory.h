@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Memory.h"
+
+using namespace CPPUNIT_NS;
+
+class test_memory
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_memory );
+    CPPUNIT_TEST( test_array );
+    CPPUNIT_TEST( test_sparse_matrix );
+    CPPUNIT_TEST( test_phases );
+    CPPUNIT_TEST( test_thread_phases );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_array( void );
+    void test_sparse_matrix( void );
+    void test_phases( void );
+    void test_thread_phases( void );
+};
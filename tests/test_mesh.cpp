@@ -0,0 +1,45 @@
+#include "test_mesh.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_mesh );
+
+
+void test_mesh::test_for_each_cell( void )
+{
+    RectangularMesh mesh;
+    mesh.setup( 1, 1, 5, 7 );
+
+    int visited = 0;
+    mesh.for_each_cell( [&] ( int cell, int row, int col, const int* edges ) {
+        CPPUNIT_ASSERT_EQUAL( visited++, cell );
+        CPPUNIT_ASSERT_EQUAL( cell, row * 7 + col );
+        for( int i = 0; i < 4; i++ )
+            CPPUNIT_ASSERT_EQUAL( mesh.edge_for_cell( cell, i ), edges[ i ] );
+    } );
+    CPPUNIT_ASSERT_EQUAL( mesh.num_cells(), visited );
+}
+
+void test_mesh::test_cell_for_edge( void )
+{
+    RectangularMesh mesh;
+    mesh.setup( 1, 1, 5, 7 );
+
+    // the cell is above its bottom edge and right of its left edge
+    const int cellOrder[ 4 ] = { 1, 0, 1, 0 };
+    for( int cell = 0; cell < mesh.num_cells(); cell++ ) {
+        for( int i = 0; i < 4; i++ ) {
+            const int edge = mesh.edge_for_cell( cell, i );
+            CPPUNIT_ASSERT_EQUAL( cell, mesh.cell_for_edge( edge, cellOrder[ i ] ) );
+            CPPUNIT_ASSERT_EQUAL( i, mesh.get_edge_order( cell, edge ) );
+            CPPUNIT_ASSERT_EQUAL( i < 2, mesh.is_horizontal_edge( edge ) );
+        }
+    }
+
+    int outer = 0;
+    for( int edge = 0; edge < mesh.num_edges(); edge++ ) {
+        const bool inner = mesh.cell_for_edge( edge, 0 ) >= 0 && mesh.cell_for_edge( edge, 1 ) >= 0;
+        CPPUNIT_ASSERT_EQUAL( inner, mesh.is_inner_edge( edge ) );
+        if( ! inner )
+            outer++;
+    }
+    CPPUNIT_ASSERT_EQUAL( mesh.num_neumann_edges() + mesh.num_dirichlet_edges(), outer );
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "RectangularMesh.h"
+
+using namespace CPPUNIT_NS;
+
+class test_mesh
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_mesh );
+    CPPUNIT_TEST( test_for_each_cell );
+    CPPUNIT_TEST( test_cell_for_edge );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_for_each_cell( void );
+    void test_cell_for_edge( void );
+};
@@ -0,0 +1,256 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "test_performance.h"
+#include "RectangularMesh.h"
+#include "SparseMatrix.h"
+#include "Vector.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_performance );
+
+namespace {
+
+const char* baseline_file = "performance-baseline.dat";
+const int repetitions = 5;
+
+struct Baseline
+{
+    double seconds;     // 0 for an operation which is not measured yet
+    double tolerance;   // allowed relative slowdown
+};
+
+// entries of the baseline file: "name seconds tolerance" per line, "-" in
+// place of the seconds for an operation which is not measured yet; the
+// comment lines (the reference machine) are kept in `header`
+map< string, Baseline > load_baseline( vector< string > & header )
+{
+    map< string, Baseline > entries;
+    ifstream file( baseline_file );
+    string line;
+    while( getline( file, line ) ) {
+        stringstream ss( line );
+        string name, seconds;
+        Baseline entry;
+        if( ! ( ss >> name ) )
+            continue;
+        if( name[ 0 ] == '#' ) {
+            header.push_back( line );
+            continue;
+        }
+        if( ! ( ss >> seconds >> entry.tolerance ) )
+            continue;
+        entry.seconds = ( seconds == "-" ) ? 0.0 : atof( seconds.c_str() );
+        entries[ name ] = entry;
+    }
+    return entries;
+}
+
+bool save_baseline( const vector< string > & header, const map< string, Baseline > & entries )
+{
+    ofstream file( baseline_file );
+    if( header.empty() )
+        file << "# performance regression baseline: name, best time [s], allowed relative slowdown" << endl;
+    for( const string & line : header )
+        file << line << endl;
+    for( const auto & entry : entries ) {
+        file << entry.first << " ";
+        if( entry.second.seconds > 0.0 )
+            file << setprecision( 4 ) << entry.second.seconds;
+        else
+            file << "-";
+        file << " " << entry.second.tolerance << endl;
+    }
+    return ! file.fail();
+}
+
+// best wall-clock time of `func` out of `repetitions` runs, `prepare` is
+// called before every run and is not timed
+template< typename Prepare, typename Func >
+double best_time( Prepare prepare, Func func )
+{
+    double best = HUGE_VAL;
+    for( int r = 0; r < repetitions; r++ ) {
+        prepare();
+        auto start = chrono::steady_clock::now();
+        func();
+        auto stop = chrono::steady_clock::now();
+        best = fmin( best, chrono::duration< double >( stop - start ).count() );
+    }
+    return best;
+}
+
+// sparsity pattern of the main system in the same order as Solver::init_main_system
+void assemble_pattern( const RectangularMesh & mesh, SparseMatrix & matrix )
+{
+    matrix.setSize( mesh.num_edges(), mesh.num_edges() );
+    matrix.reserve( 7 * ( mesh.num_edges() - mesh.num_neumann_edges() - mesh.num_dirichlet_edges() ) + 4 * mesh.num_neumann_edges() + mesh.num_dirichlet_edges() );
+    for( IndexType row = 0; row < mesh.num_edges(); row++ ) {
+        if( mesh.is_dirichlet_boundary( row ) ) {
+            matrix.setElement( row, row, 1.0 );
+            continue;
+        }
+        for( IndexType i = 0; i < 2; i++ ) {
+            const IndexType cell = mesh.cell_for_edge( row, i );
+            if( cell < 0 )
+                continue;
+            for( IndexType j = 0; j < 4; j++ ) {
+                const IndexType column = mesh.edge_for_cell( cell, j );
+                if( ! mesh.is_dirichlet_boundary( column ) )
+                    matrix.setElement( row, column, 1.0 );
+            }
+        }
+    }
+}
+
+// values of a diagonally dominant system with the same pattern: every cell
+// adds a local matrix with 3.1 on the diagonal and -1 elsewhere
+void assemble_values( const RectangularMesh & mesh, SparseMatrix & matrix )
+{
+    matrix.resetValues();
+    mesh.for_each_cell( [&matrix, &mesh] ( int, int, int, const int* edges ) {
+        for( int i = 0; i < 4; i++ ) {
+            if( mesh.is_dirichlet_boundary( edges[ i ] ) )
+                continue;
+            for( int j = 0; j < 4; j++ ) {
+                if( ! mesh.is_dirichlet_boundary( edges[ j ] ) )
+                    matrix.addElement( edges[ i ], edges[ j ], ( i == j ) ? 3.1 : -1.0 );
+            }
+        }
+    } );
+    for( IndexType row = 0; row < mesh.num_edges(); row++ ) {
+        if( mesh.is_dirichlet_boundary( row ) )
+            matrix.addElement( row, row, 1.0 );
+    }
+}
+
+} // namespace
+
+
+void test_performance::check( const string & name, double seconds )
+{
+    vector< string > header;
+    map< string, Baseline > entries = load_baseline( header );
+    auto entry = entries.find( name );
+
+    const char* update = getenv( "PERFORMANCE_BASELINE_UPDATE" );
+    if( update && string( update ) == "1" ) {
+        const double tolerance = ( entry != entries.end() ) ? entry->second.tolerance : 1.0;
+        entries[ name ] = { seconds, tolerance };
+        CPPUNIT_ASSERT_MESSAGE( "failed to write the performance baseline", save_baseline( header, entries ) );
+        return;
+    }
+
+    // a new operation must be recorded with PERFORMANCE_BASELINE_UPDATE=1,
+    // otherwise it would never be checked
+    if( entry == entries.end() ) {
+        stringstream message;
+        message << "no performance baseline for " << name << " (measured " << seconds
+                << " s), record it with PERFORMANCE_BASELINE_UPDATE=1";
+        CPPUNIT_FAIL( message.str() );
+    }
+
+    // listed, but the reference machine has not measured it yet
+    const Baseline & baseline = entry->second;
+    if( baseline.seconds <= 0.0 ) {
+        cerr << "no performance baseline measured for " << name << " (measured " << seconds << " s)" << endl;
+        return;
+    }
+
+    const double change = seconds / baseline.seconds - 1.0;
+    if( change > baseline.tolerance ) {
+        stringstream message;
+        message << "performance regression in " << name << ": measured " << seconds << " s, baseline "
+                << baseline.seconds << " s (" << showpos << fixed << setprecision( 0 ) << 100 * change
+                << " %, allowed " << 100 * baseline.tolerance << " %)";
+        CPPUNIT_FAIL( message.str() );
+    }
+}
+
+void test_performance::test_csr_pattern( void )
+{
+    RectangularMesh mesh;
+    mesh.setup( 1, 1, 512, 512 );
+
+    SparseMatrix matrix;
+    const double seconds = best_time( [] () {},
+                                      [&mesh, &matrix] () { assemble_pattern( mesh, matrix ); } );
+    CPPUNIT_ASSERT_EQUAL( (IndexType) mesh.num_edges(), matrix.getRows() );
+    check( "csr_pattern_512", seconds );
+}
+
+void test_performance::test_csr_values( void )
+{
+    RectangularMesh mesh;
+    mesh.setup( 1, 1, 512, 512 );
+
+    SparseMatrix matrix;
+    assemble_pattern( mesh, matrix );
+    const IndexType nonzeros = matrix.nonzeros();
+    const double seconds = best_time( [] () {},
+                                      [&mesh, &matrix] () { assemble_values( mesh, matrix ); } );
+    // the pattern is fixed
+    CPPUNIT_ASSERT_EQUAL( nonzeros, matrix.nonzeros() );
+    check( "csr_values_512", seconds );
+}
+
+void test_performance::test_linear_solve( void )
+{
+    RectangularMesh mesh;
+    mesh.setup( 1, 1, 32, 32 );
+
+    SparseMatrix matrix;
+    assemble_pattern( mesh, matrix );
+    Vector x, rhs;
+    x.setSize( mesh.num_edges() );
+    rhs.setSize( mesh.num_edges() );
+    rhs.setAllElements( 1.0 );
+
+    // new values before every solve, so that the numeric factorization is
+    // recomputed (the symbolic one is cached after the first run)
+    bool status = true;
+    const double seconds = best_time( [&mesh, &matrix] () { assemble_values( mesh, matrix ); },
+                                      [&matrix, &x, &rhs, &status] () { status = matrix.linear_solve( x, rhs ) && status; } );
+    CPPUNIT_ASSERT( status );
+    check( "linear_solve_32", seconds );
+}
+
+void test_performance::test_vector_norm( void )
+{
+    const IndexType size = 1 << 22;
+    Vector v;
+    v.setSize( size );
+    v.setAllElements( 0.5 );
+
+    RealType norm = 0.0;
+    const double seconds = best_time( [] () {},
+                                      [&v, &norm] () { norm = v.norm(); } );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5 * sqrt( (double) size ), norm, 1e-6 );
+    check( "vector_norm_4M", seconds );
+}
+
+void test_performance::test_array_save_load( void )
+{
+    const IndexType size = 1 << 18;
+    Array a, b;
+    a.setSize( size );
+    b.setSize( size );
+    for( IndexType i = 0; i < size; i++ )
+        a[ i ] = ( i % 1000 ) * 0.25;
+
+    bool status = true;
+    const double seconds = best_time( [] () {},
+        [&a, &b, &status] () {
+            status = a.save( "test-performance-array.dat" ) && b.load( "test-performance-array.dat" ) && status;
+        } );
+    CPPUNIT_ASSERT( status );
+    CPPUNIT_ASSERT_EQUAL( a[ size - 1 ], b[ size - 1 ] );
+    check( "array_save_load_256k", seconds );
+}
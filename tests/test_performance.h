@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace CPPUNIT_NS;
+
+// Performance regression tests: the best time of a few repetitions of each
+// operation is compared with tests/performance-baseline.dat and the test
+// fails when it is slower than the baseline by more than the tolerance of
+// the entry, or when the operation has no entry. Entries without a time
+// ("-") are not checked until they are measured. Run with
+// PERFORMANCE_BASELINE_UPDATE=1 to record the measured times as the new
+// baseline (on the reference machine named in the file header).
+class test_performance
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_performance );
+    CPPUNIT_TEST( test_csr_pattern );
+    CPPUNIT_TEST( test_csr_values );
+    CPPUNIT_TEST( test_linear_solve );
+    CPPUNIT_TEST( test_vector_norm );
+    CPPUNIT_TEST( test_array_save_load );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_csr_pattern( void );
+    void test_csr_values( void );
+    void test_linear_solve( void );
+    void test_vector_norm( void );
+    void test_array_save_load( void );
+
+    // compare the measured time with the baseline entry `name`
+    void check( const std::string & name, double seconds );
+};
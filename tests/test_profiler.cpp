@@ -0,0 +1,65 @@
+#include <sstream>
+#include <thread>
+
+#include "test_profiler.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_profiler );
+
+
+void test_profiler::test_record( void )
+{
+    Profiler profiler;
+    profiler.record( Profiler::NUMERIC, 0.5 );
+    profiler.record( Profiler::NUMERIC, 1.5 );
+    CPPUNIT_ASSERT_EQUAL( 2u, profiler.count( Profiler::NUMERIC ) );
+    CPPUNIT_ASSERT_EQUAL( 2.0, profiler.total( Profiler::NUMERIC ) );
+    CPPUNIT_ASSERT_EQUAL( 0u, profiler.count( Profiler::SOLVE ) );
+
+    {
+        Profiler::Scope scope( profiler, Profiler::SOLVE );
+        this_thread::sleep_for( chrono::milliseconds( 2 ) );
+    }
+    CPPUNIT_ASSERT_EQUAL( 1u, profiler.count( Profiler::SOLVE ) );
+    CPPUNIT_ASSERT( profiler.total( Profiler::SOLVE ) >= 0.002 );
+}
+
+void test_profiler::test_report( void )
+{
+    Profiler profiler;
+    for( int i = 1; i <= 100; i++ )
+        profiler.record( Profiler::ASSEMBLY, i * 1e-3 );
+
+    stringstream ss;
+    profiler.report( ss );
+    const string table = ss.str();
+    // phases without samples are omitted
+    CPPUNIT_ASSERT( table.find( Profiler::phase_name( Profiler::ASSEMBLY ) ) != string::npos );
+    CPPUNIT_ASSERT( table.find( Profiler::phase_name( Profiler::SNAPSHOT ) ) == string::npos );
+    // count, total, share, mean, min, p50, p90, p99, max
+    CPPUNIT_ASSERT( table.find( "100      5.050  100.0    50.500     1.000    51.000    91.000   100.000   100.000" ) != string::npos );
+}
+
+void test_profiler::test_counters( void )
+{
+    Profiler profiler;
+    // perf_event_open may be forbidden, e.g. in containers
+    if( ! profiler.enable_counters() )
+        return;
+    const PerfCounters & counters = *profiler.get_counters();
+    const int task_clock = counters.find( "task-clock" );
+    CPPUNIT_ASSERT_EQUAL( -1, counters.find( "unknown" ) );
+
+    // the work of a thread created inside the scope is counted as well
+    volatile double sum = 0.0;
+    {
+        Profiler::Scope scope( profiler, Profiler::ASSEMBLY );
+        thread worker( [&sum] () { for( int i = 0; i < 1000000; i++ ) sum = sum + i; } );
+        worker.join();
+    }
+    CPPUNIT_ASSERT_EQUAL( (size_t) counters.size(), profiler.counter_totals( Profiler::ASSEMBLY ).size() );
+    if( task_clock >= 0 )
+        CPPUNIT_ASSERT( profiler.counter_totals( Profiler::ASSEMBLY )[ task_clock ] > 100000 );
+    CPPUNIT_ASSERT_EQUAL( (uint64_t) 0, profiler.counter_totals( Profiler::SOLVE )[ 0 ] );
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Profiler.h"
+
+using namespace CPPUNIT_NS;
+
+class test_profiler
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_profiler );
+    CPPUNIT_TEST( test_record );
+    CPPUNIT_TEST( test_report );
+    CPPUNIT_TEST( test_counters );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_record( void );
+    void test_report( void );
+    void test_counters( void );
+};
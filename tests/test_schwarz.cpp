@@ -0,0 +1,59 @@
+#include <cmath>
+
+#include "test_schwarz.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_schwarz );
+
+
+void test_schwarz::test_solve( void )
+{
+    // nonsymmetric convection-diffusion matrix with a Dirichlet-like first row
+    const IndexType n = 40;
+    SparseMatrix A;
+    A.setSize( n, n );
+    A.setElement( 0, 0, 1.0 );
+    for( IndexType i = 1; i < n; i++ ) {
+        A.setElement( i, i - 1, -1.5e-3 );
+        A.setElement( i, i, 2.2e-3 );
+        if( i < n - 1 )
+            A.setElement( i, i + 1, -0.5e-3 );
+    }
+
+    Vector b, x, x_direct;
+    b.setSize( n );
+    x.setSize( n );
+    x_direct.setSize( n );
+    b[ 0 ] = 1e5;
+    for( IndexType i = 1; i < n; i++ )
+        b[ i ] = 1e-3 * sin( i );
+    x.setAllElements( 0.0 );
+
+    // 4 subdomains of 10 unknowns extended by 2 on both sides
+    vector< vector< IndexType > > subdomains( 4 );
+    vector< IndexType > owner( n );
+    for( IndexType i = 0; i < n; i++ ) {
+        owner[ i ] = i / 10;
+        for( IndexType s = 0; s < 4; s++ ) {
+            if( i >= (IndexType) s * 10 - 2 && i < (IndexType) s * 10 + 12 )
+                subdomains[ s ].push_back( i );
+        }
+    }
+
+    ThreadPool pool( 1 );
+    SchwarzSolver schwarz( 1e-12 );
+    CPPUNIT_ASSERT( schwarz.setup( subdomains, owner, &pool ) );
+    CPPUNIT_ASSERT_EQUAL( 4u, schwarz.num_subdomains() );
+    CPPUNIT_ASSERT( schwarz.solve( A, x, b ) );
+    CPPUNIT_ASSERT( schwarz.iterations > 0 );
+
+    CPPUNIT_ASSERT( A.linear_solve( x_direct, b ) );
+    for( IndexType i = 0; i < n; i++ )
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( x_direct[ i ], x[ i ], 1e-9 * fabs( x_direct[ i ] ) );
+
+    // the solution is a fixed point
+    const unsigned iterations = schwarz.iterations;
+    CPPUNIT_ASSERT( schwarz.solve( A, x, b ) );
+    CPPUNIT_ASSERT( schwarz.iterations - iterations <= 1 );
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "SchwarzSolver.h"
+
+using namespace CPPUNIT_NS;
+
+class test_schwarz
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_schwarz );
+    CPPUNIT_TEST( test_solve );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_solve( void );
+};
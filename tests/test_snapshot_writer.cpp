@@ -0,0 +1,52 @@
+#include <sstream>
+
+#include "test_snapshot_writer.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_snapshot_writer );
+
+
+void test_snapshot_writer::test_write( void )
+{
+    const IndexType size = 1000;
+    const unsigned snapshots = 5;
+    Vector v;
+    v.setSize( size );
+
+    // a single buffer: every write after the first one may wait
+    SnapshotWriter writer( 1 );
+    for( unsigned s = 0; s < snapshots; s++ ) {
+        for( IndexType i = 0; i < size; i++ )
+            v[ i ] = s * size + i;
+        stringstream name;
+        name << "test-snapshot-" << s << ".dat";
+        CPPUNIT_ASSERT( writer.write( name.str(), v ) );
+    }
+    CPPUNIT_ASSERT( writer.finish() );
+    CPPUNIT_ASSERT_EQUAL( snapshots, writer.written );
+    CPPUNIT_ASSERT( writer.waits < snapshots );
+
+    // the copies were taken at the time of write()
+    for( unsigned s = 0; s < snapshots; s++ ) {
+        stringstream name;
+        name << "test-snapshot-" << s << ".dat";
+        Vector loaded;
+        loaded.setSize( size );
+        CPPUNIT_ASSERT( loaded.load( name.str() ) );
+        CPPUNIT_ASSERT_EQUAL( (RealType) s * size, loaded[ 0 ] );
+        CPPUNIT_ASSERT_EQUAL( (RealType) s * size + size - 1, loaded[ size - 1 ] );
+    }
+}
+
+void test_snapshot_writer::test_failure( void )
+{
+    Vector v;
+    v.setSize( 10 );
+    v.setAllElements( 1.0 );
+
+    SnapshotWriter writer;
+    CPPUNIT_ASSERT( writer.write( "nonexistent-directory/test-snapshot.dat", v ) );
+    CPPUNIT_ASSERT( ! writer.finish() );
+    CPPUNIT_ASSERT_EQUAL( 0u, writer.written );
+}
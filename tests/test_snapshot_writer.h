@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "SnapshotWriter.h"
+
+using namespace CPPUNIT_NS;
+
+class test_snapshot_writer
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_snapshot_writer );
+    CPPUNIT_TEST( test_write );
+    CPPUNIT_TEST( test_failure );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_write( void );
+    void test_failure( void );
+};
@@ -1,8 +1,15 @@
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
 
 #include "test_sparse.h"
+#include "Memory.h"
 
 using namespace std;
 
@@ -90,3 +97,250 @@ void test_sparse::test_solve( void )
     CPPUNIT_ASSERT_EQUAL( 1.5151515151515151, x[ 2 ] );
 }
 
+
+void test_sparse::test_symbolic_cache( void )
+{
+    unsigned order = 3;
+    Vector x;
+    x.setSize( order );
+    Vector b;
+    b.setSize( order );
+    b[ 0 ] = 4.0;
+    b[ 1 ] = 5.0;
+    b[ 2 ] = 6.0;
+
+    // same pattern as in test_solve, different values
+    SparseMatrix m;
+    m.setSize( order, order );
+    m.setElement( 0, 0, 2.0 );
+    m.setElement( 2, 1, 4.0 );
+    m.setElement( 1, 2, 5.0 );
+    m.linear_solve( x, b );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, x[ 0 ], 1e-14 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.5, x[ 1 ], 1e-14 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, x[ 2 ], 1e-14 );
+
+    // different pattern of the same size must not reuse the cached analysis
+    SparseMatrix d;
+    d.setSize( order, order );
+    d.setElement( 0, 0, 2.0 );
+    d.setElement( 1, 1, 4.0 );
+    d.setElement( 2, 2, 5.0 );
+    d.linear_solve( x, b );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, x[ 0 ], 1e-14 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.25, x[ 1 ], 1e-14 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.2, x[ 2 ], 1e-14 );
+}
+
+// 5x5 tridiagonal matrix solved once, its pattern is not used by other tests
+static void solve_tridiagonal( void )
+{
+    SparseMatrix m;
+    m.setSize( 5, 5 );
+    for( IndexType i = 0; i < 5; i++ ) {
+        m.setElement( i, i, 4.0 );
+        if( i > 0 )
+            m.setElement( i, i - 1, -1.0 );
+        if( i < 4 )
+            m.setElement( i, i + 1, -1.0 );
+    }
+    Vector x, b;
+    x.setSize( 5 );
+    b.setSize( 5 );
+    b.setAllElements( 1.0 );
+    CPPUNIT_ASSERT( m.linear_solve( x, b ) );
+}
+
+void test_sparse::test_symbolic_cache_eviction( void )
+{
+    // without a limit for unused entries only the factorizations in use are kept
+    SparseMatrix::set_symbolic_cache_limit( 0 );
+    const size_t base = Memory::live( Memory::UMFPACK_SYMBOLIC );
+    {
+        SparseMatrix m;
+        m.setSize( 2, 2 );
+        m.setElement( 0, 0, 1.0 );
+        m.setElement( 1, 1, 1.0 );
+        Vector x, b;
+        x.setSize( 2 );
+        b.setSize( 2 );
+        CPPUNIT_ASSERT( m.linear_solve( x, b ) );
+        CPPUNIT_ASSERT( Memory::live( Memory::UMFPACK_SYMBOLIC ) > base );
+
+        // the pattern changes, the old entry is not used any more
+        m.setElement( 0, 1, 1.0 );
+        m.setElement( 0, 1, 0.0 );
+        CPPUNIT_ASSERT_EQUAL( base, Memory::live( Memory::UMFPACK_SYMBOLIC ) );
+        CPPUNIT_ASSERT( m.linear_solve( x, b ) );
+    }
+    CPPUNIT_ASSERT_EQUAL( base, Memory::live( Memory::UMFPACK_SYMBOLIC ) );
+
+    // with a limit an unused entry is kept for the next matrix with its pattern
+    SparseMatrix::set_symbolic_cache_limit( 1 << 20 );
+    solve_tridiagonal();
+    const size_t cached = Memory::live( Memory::UMFPACK_SYMBOLIC );
+    CPPUNIT_ASSERT( cached > base );
+    solve_tridiagonal();
+    CPPUNIT_ASSERT_EQUAL( cached, Memory::live( Memory::UMFPACK_SYMBOLIC ) );
+
+    // lowering the limit frees it
+    SparseMatrix::set_symbolic_cache_limit( 0 );
+    CPPUNIT_ASSERT_EQUAL( base, Memory::live( Memory::UMFPACK_SYMBOLIC ) );
+    SparseMatrix::set_symbolic_cache_limit( 64 << 20 );
+}
+
+// names of the files in a directory
+static vector< string > list_directory( const string & dir )
+{
+    vector< string > names;
+    DIR* d = opendir( dir.c_str() );
+    if( d == nullptr )
+        return names;
+    while( dirent* entry = readdir( d ) ) {
+        const string name = entry->d_name;
+        if( name != "." && name != ".." )
+            names.push_back( name );
+    }
+    closedir( d );
+    return names;
+}
+
+void test_sparse::test_symbolic_cache_dir( void )
+{
+    char dir[] = "/tmp/test-symbolic-cache-XXXXXX";
+    CPPUNIT_ASSERT( mkdtemp( dir ) != nullptr );
+    SparseMatrix::set_symbolic_cache_dir( dir );
+
+    // threads computing the same new pattern concurrently write the cache
+    // files under distinct temporary names
+    const IndexType order = 37;
+    vector< thread > threads;
+    vector< int > solved( 4, 0 );
+    for( unsigned t = 0; t < solved.size(); t++ )
+        threads.emplace_back( [&solved, t, order] () {
+            SparseMatrix m;
+            m.setSize( order, order );
+            for( IndexType i = 0; i < order; i++ ) {
+                m.setElement( i, i, 4.0 + t );
+                m.setElement( i, ( i * 7 + 3 ) % order, 1.0 );
+            }
+            Vector x, b;
+            x.setSize( order );
+            b.setSize( order );
+            b.setAllElements( 1.0 );
+            solved[ t ] = m.linear_solve( x, b );
+        } );
+    for( auto & t : threads )
+        t.join();
+    SparseMatrix::set_symbolic_cache_dir( "" );
+    for( int s : solved )
+        CPPUNIT_ASSERT( s );
+
+    // one factorization with its pattern, no temporary files left over
+    const vector< string > files = list_directory( dir );
+    unsigned umf = 0, pattern = 0;
+    for( const string & name : files ) {
+        CPPUNIT_ASSERT( name.find( ".tmp." ) == string::npos );
+        umf += name.size() > 4 && name.compare( name.size() - 4, 4, ".umf" ) == 0;
+        pattern += name.size() > 8 && name.compare( name.size() - 8, 8, ".pattern" ) == 0;
+        remove( ( string( dir ) + "/" + name ).c_str() );
+    }
+    rmdir( dir );
+    CPPUNIT_ASSERT_EQUAL( 1u, umf );
+    CPPUNIT_ASSERT_EQUAL( 1u, pattern );
+    CPPUNIT_ASSERT_EQUAL( (size_t) 2, files.size() );
+}
+
+void test_sparse::test_refactorization( void )
+{
+    SparseMatrix m;
+    m.setSize( 2, 2 );
+    m.setElement( 0, 0, 2.0 );
+    m.setElement( 1, 1, 1.0 );
+    Vector x, b;
+    x.setSize( 2 );
+    b.setSize( 2 );
+    b[ 0 ] = 1.0;
+    b[ 1 ] = 1.0;
+    CPPUNIT_ASSERT( m.linear_solve( x, b ) );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, x[ 0 ], 1e-14 );
+
+    // new value in the pattern
+    m.setElement( 0, 0, 4.0 );
+    CPPUNIT_ASSERT( m.linear_solve( x, b ) );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.25, x[ 0 ], 1e-14 );
+
+    // new element outside the pattern: 4 x0 + 2 x1 = 1, x1 = 1
+    m.setElement( 0, 1, 2.0 );
+    CPPUNIT_ASSERT( m.linear_solve( x, b ) );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( -0.25, x[ 0 ], 1e-14 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, x[ 1 ], 1e-14 );
+
+    // removed element
+    m.setElement( 0, 1, 0.0 );
+    CPPUNIT_ASSERT( m.linear_solve( x, b ) );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.25, x[ 0 ], 1e-14 );
+}
+
+void test_sparse::test_fixed_pattern( void )
+{
+    SparseMatrix m;
+    m.setSize( 3, 3 );
+    m.setElement( 0, 0, 1.0 );
+    m.setElement( 1, 2, 2.0 );
+    m.setElement( 2, 1, 3.0 );
+
+    m.resetValues();
+    CPPUNIT_ASSERT_EQUAL( 0.0, m.getElement( 1, 2 ) );
+
+    // elements in the pattern can be accumulated, others are rejected
+    CPPUNIT_ASSERT_EQUAL( true, m.addElement( 1, 2, 1.5 ) );
+    CPPUNIT_ASSERT_EQUAL( true, m.addElement( 1, 2, 1.5 ) );
+    CPPUNIT_ASSERT_EQUAL( false, m.addElement( 1, 1, 1.0 ) );
+    CPPUNIT_ASSERT_EQUAL( 3.0, m.getElement( 1, 2 ) );
+    CPPUNIT_ASSERT_EQUAL( 0.0, m.getElement( 1, 1 ) );
+
+    // setElement on a stored zero must not duplicate the element
+    m.setElement( 0, 0, 4.0 );
+    m.setElement( 0, 0, 5.0 );
+    CPPUNIT_ASSERT_EQUAL( 5.0, m.getElement( 0, 0 ) );
+    m.setElement( 0, 0, 0.0 );
+    CPPUNIT_ASSERT_EQUAL( 0.0, m.getElement( 0, 0 ) );
+    CPPUNIT_ASSERT_EQUAL( false, m.addElement( 0, 0, 1.0 ) );
+}
+
+void test_sparse::test_multiply_extract( void )
+{
+    SparseMatrix m;
+    m.setSize( 3, 3 );
+    m.setElement( 0, 0, 2.0 );
+    m.setElement( 0, 2, 1.0 );
+    m.setElement( 1, 1, 3.0 );
+    m.setElement( 2, 0, -1.0 );
+    m.setElement( 2, 2, 4.0 );
+
+    Vector x, y;
+    x.setSize( 3 );
+    y.setSize( 3 );
+    x[ 0 ] = 1.0;
+    x[ 1 ] = 2.0;
+    x[ 2 ] = 3.0;
+    m.multiply( x, y );
+    CPPUNIT_ASSERT_EQUAL( 5.0, y[ 0 ] );
+    CPPUNIT_ASSERT_EQUAL( 6.0, y[ 1 ] );
+    CPPUNIT_ASSERT_EQUAL( 11.0, y[ 2 ] );
+
+    // principal submatrix of rows/columns 0 and 2
+    SparseMatrix sub;
+    m.extract( { 0, 2 }, sub );
+    CPPUNIT_ASSERT_EQUAL( 2, sub.getRows() );
+    CPPUNIT_ASSERT_EQUAL( 2.0, sub.getElement( 0, 0 ) );
+    CPPUNIT_ASSERT_EQUAL( 1.0, sub.getElement( 0, 1 ) );
+    CPPUNIT_ASSERT_EQUAL( -1.0, sub.getElement( 1, 0 ) );
+    CPPUNIT_ASSERT_EQUAL( 4.0, sub.getElement( 1, 1 ) );
+
+    // same pattern with new values
+    m.setElement( 2, 2, 5.0 );
+    m.extract( { 0, 2 }, sub );
+    CPPUNIT_ASSERT_EQUAL( 5.0, sub.getElement( 1, 1 ) );
+}
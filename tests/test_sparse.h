@@ -16,10 +16,22 @@ class test_sparse
     CPPUNIT_TEST( test_matrix_creation );
     CPPUNIT_TEST( test_matrix_save_load );
     CPPUNIT_TEST( test_solve );
+    CPPUNIT_TEST( test_symbolic_cache );
+    CPPUNIT_TEST( test_symbolic_cache_dir );
+    CPPUNIT_TEST( test_symbolic_cache_eviction );
+    CPPUNIT_TEST( test_fixed_pattern );
+    CPPUNIT_TEST( test_refactorization );
+    CPPUNIT_TEST( test_multiply_extract );
     CPPUNIT_TEST_SUITE_END();
 
 protected:
     void test_matrix_creation( void );
     void test_matrix_save_load( void );
     void test_solve( void );
+    void test_symbolic_cache( void );
+    void test_symbolic_cache_dir( void );
+    void test_symbolic_cache_eviction( void );
+    void test_fixed_pattern( void );
+    void test_refactorization( void );
+    void test_multiply_extract( void );
 };
@@ -0,0 +1,98 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "test_telemetry.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_telemetry );
+
+namespace {
+
+unsigned count_lines( istream & is, const string & prefix )
+{
+    unsigned count = 0;
+    string line;
+    while( getline( is, line ) )
+        if( line.compare( 0, prefix.size(), prefix ) == 0 )
+            count++;
+    return count;
+}
+
+} // namespace
+
+
+void test_telemetry::test_json_lines( void )
+{
+    Telemetry telemetry;
+    CPPUNIT_ASSERT( telemetry.start( nullptr, Telemetry::QUIET, 1.0, "test-telemetry.jsonl" ) );
+    CPPUNIT_ASSERT( telemetry.active() );
+    for( unsigned i = 1; i <= 10; i++ ) {
+        StepRecord record;
+        record.step = i;
+        record.time = 0.5 * i;
+        record.tau = 0.5;
+        record.phase_seconds[ Profiler::ASSEMBLY ] = 1e-3;
+        record.krylov_iterations = 7;
+        telemetry.publish( record );
+    }
+    telemetry.stop();
+    CPPUNIT_ASSERT( ! telemetry.active() );
+    CPPUNIT_ASSERT_EQUAL( (uint64_t) 10, telemetry.published() );
+    CPPUNIT_ASSERT_EQUAL( (uint64_t) 0, telemetry.dropped_records() );
+
+    ifstream file( "test-telemetry.jsonl" );
+    string line;
+    unsigned lines = 0;
+    while( getline( file, line ) ) {
+        lines++;
+        stringstream expected;
+        expected << "{\"step\": " << lines << ", \"time\": " << 0.5 * lines << ", \"tau\": 0.5";
+        CPPUNIT_ASSERT_EQUAL( expected.str(), line.substr( 0, expected.str().size() ) );
+        CPPUNIT_ASSERT( line.find( "\"assembly\": 0.001" ) != string::npos );
+        CPPUNIT_ASSERT( line.find( "\"krylov_iterations\": 7" ) != string::npos );
+        CPPUNIT_ASSERT_EQUAL( '}', line.back() );
+    }
+    CPPUNIT_ASSERT_EQUAL( 10u, lines );
+}
+
+void test_telemetry::test_rate_limit( void )
+{
+    stringstream console;
+    Telemetry telemetry;
+    CPPUNIT_ASSERT( telemetry.start( &console, Telemetry::PROGRESS, 1000.0, "" ) );
+    for( unsigned i = 1; i <= 100; i++ ) {
+        StepRecord record;
+        record.step = i;
+        telemetry.publish( record );
+    }
+    telemetry.stop();
+    // the first and the last step
+    CPPUNIT_ASSERT_EQUAL( 2u, count_lines( console, "Time:" ) );
+
+    stringstream all;
+    CPPUNIT_ASSERT( telemetry.start( &all, Telemetry::STEPS, 1000.0, "" ) );
+    for( unsigned i = 1; i <= 5; i++ )
+        telemetry.publish( StepRecord() );
+    telemetry.stop();
+    CPPUNIT_ASSERT_EQUAL( 5u, count_lines( all, "Time:" ) );
+
+    // no sink, no thread
+    CPPUNIT_ASSERT( telemetry.start( &console, Telemetry::QUIET, 1.0, "" ) );
+    CPPUNIT_ASSERT( ! telemetry.active() );
+}
+
+void test_telemetry::test_full_buffer( void )
+{
+    stringstream console;
+    Telemetry telemetry( 2 );
+    CPPUNIT_ASSERT( telemetry.start( &console, Telemetry::STEPS, 0.0, "" ) );
+    const unsigned n = 10000;
+    for( unsigned i = 0; i < n; i++ )
+        telemetry.publish( StepRecord() );
+    telemetry.stop();
+    // the producer never waits, every record is either written or dropped
+    CPPUNIT_ASSERT_EQUAL( (uint64_t) n, telemetry.published() + telemetry.dropped_records() );
+    CPPUNIT_ASSERT_EQUAL( (unsigned) telemetry.published(), count_lines( console, "Time:" ) );
+}
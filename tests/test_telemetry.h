@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Telemetry.h"
+
+using namespace CPPUNIT_NS;
+
+class test_telemetry
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_telemetry );
+    CPPUNIT_TEST( test_json_lines );
+    CPPUNIT_TEST( test_rate_limit );
+    CPPUNIT_TEST( test_full_buffer );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_json_lines( void );
+    void test_rate_limit( void );
+    void test_full_buffer( void );
+};
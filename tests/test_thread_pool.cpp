@@ -0,0 +1,74 @@
+#include <atomic>
+#include <vector>
+
+#include "parallel.h"
+#include "test_thread_pool.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_thread_pool );
+
+
+void test_thread_pool::test_run_all( void )
+{
+    ThreadPool pool( 4 );
+    CPPUNIT_ASSERT_EQUAL( 4u, pool.size() );
+
+    atomic< int > sum( 0 );
+    for( int round = 0; round < 2; round++ ) {
+        for( int i = 1; i <= 100; i++ )
+            pool.submit( [&sum, i] ( unsigned worker ) {
+                CPPUNIT_ASSERT( worker < 4 );
+                sum += i;
+            } );
+        pool.wait();
+        CPPUNIT_ASSERT_EQUAL( ( round + 1 ) * 5050, sum.load() );
+    }
+}
+
+void test_thread_pool::test_stealing( void )
+{
+    // the first task blocks worker 0 until all other tasks are done, so the
+    // remaining tasks of its queue have to be stolen by worker 1
+    ThreadPool pool( 2 );
+    atomic< int > finished( 0 );
+    pool.submit( [&finished] ( unsigned ) {
+        while( finished.load() < 9 ) {}
+        finished++;
+    } );
+    for( int i = 1; i < 10; i++ )
+        pool.submit( [&finished] ( unsigned ) { finished++; } );
+    pool.wait();
+
+    CPPUNIT_ASSERT_EQUAL( 10, finished.load() );
+    CPPUNIT_ASSERT( pool.steals() >= 4 );
+}
+
+void test_thread_pool::test_parallel_for( void )
+{
+    atomic< int > initialized( 0 );
+    ThreadPool pool( 3, [&initialized] ( unsigned ) { initialized++; } );
+
+    // every element is visited exactly once, by the same workers in all calls
+    vector< int > visits( 1000, 0 );
+    for( int call = 0; call < 50; call++ )
+        parallel_for( &pool, visits.size(), [&visits] ( int begin, int end ) {
+            for( int i = begin; i < end; i++ )
+                visits[ i ]++;
+        } );
+    for( int v : visits )
+        CPPUNIT_ASSERT_EQUAL( 50, v );
+    CPPUNIT_ASSERT_EQUAL( 3, initialized.load() );
+
+    // fewer elements than threads, and no pool
+    parallel_for( &pool, 2, [&visits] ( int begin, int end ) {
+        CPPUNIT_ASSERT_EQUAL( begin + 1, end );
+        visits[ begin ] = -1;
+    } );
+    parallel_for( nullptr, 3, [&visits] ( int begin, int end ) {
+        CPPUNIT_ASSERT_EQUAL( 0, begin );
+        CPPUNIT_ASSERT_EQUAL( 3, end );
+    } );
+    CPPUNIT_ASSERT_EQUAL( -1, visits[ 0 ] );
+    CPPUNIT_ASSERT_EQUAL( -1, visits[ 1 ] );
+}
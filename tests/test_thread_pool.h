@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "ThreadPool.h"
+
+using namespace CPPUNIT_NS;
+
+class test_thread_pool
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_thread_pool );
+    CPPUNIT_TEST( test_run_all );
+    CPPUNIT_TEST( test_stealing );
+    CPPUNIT_TEST( test_parallel_for );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_run_all( void );
+    void test_stealing( void );
+    void test_parallel_for( void );
+};
@@ -0,0 +1,113 @@
+#include <cstdint>
+
+#include "Vector.h"
+#include "test_time_series.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_time_series );
+
+
+// 3x4 mesh: 12 cells, 31 edges
+const IndexType rows = 3;
+const IndexType cols = 4;
+const IndexType cells = rows * cols;
+const IndexType edges = rows * ( cols + 1 ) + cols * ( rows + 1 );
+const unsigned frames = 3;
+
+static bool write_series( const string & file_name, TimeSeries::Type type )
+{
+    TimeSeriesWriter writer;
+    if( ! writer.add_field( "pressure", TimeSeries::CELLS, cells, type ) ||
+        ! writer.add_field( "ptrace", TimeSeries::EDGES, edges, type ) ||
+        ! writer.open( file_name, 10.0, 5.0, rows, cols ) )
+        return false;
+
+    Vector pressure, ptrace;
+    pressure.setSize( cells );
+    ptrace.setSize( edges );
+    for( unsigned f = 0; f < frames; f++ ) {
+        for( IndexType i = 0; i < cells; i++ )
+            pressure[ i ] = 1e5 + f * 100 + i + 0.25;
+        for( IndexType i = 0; i < edges; i++ )
+            ptrace[ i ] = -( f * 100.0 + i );
+        if( ! writer.append( 0.5 * f, { &pressure, &ptrace } ) )
+            return false;
+    }
+    return writer.close();
+}
+
+void test_time_series::test_round_trip( void )
+{
+    CPPUNIT_ASSERT( write_series( "test-series.snap", TimeSeries::FLOAT64 ) );
+
+    TimeSeriesReader reader;
+    CPPUNIT_ASSERT( reader.open( "test-series.snap" ) );
+    const TimeSeriesHeader & header = reader.get_header();
+    CPPUNIT_ASSERT_EQUAL( (int32_t) rows, header.rows );
+    CPPUNIT_ASSERT_EQUAL( (int32_t) cols, header.cols );
+    CPPUNIT_ASSERT_EQUAL( 10.0, header.width );
+    CPPUNIT_ASSERT_EQUAL( 5.0, header.height );
+    CPPUNIT_ASSERT_EQUAL( frames, reader.num_frames() );
+    CPPUNIT_ASSERT_EQUAL( 2u, reader.num_fields() );
+    // frames and fields are aligned for vectorized access in place
+    CPPUNIT_ASSERT_EQUAL( (uint64_t) 0, header.data_offset % TimeSeries::alignment );
+    CPPUNIT_ASSERT_EQUAL( (uint64_t) 0, header.frame_bytes % TimeSeries::alignment );
+
+    const int p = reader.find_field( "pressure" );
+    const int t = reader.find_field( "ptrace" );
+    CPPUNIT_ASSERT_EQUAL( 0, p );
+    CPPUNIT_ASSERT_EQUAL( 1, t );
+    CPPUNIT_ASSERT_EQUAL( -1, reader.find_field( "velocity" ) );
+    CPPUNIT_ASSERT_EQUAL( (uint32_t) TimeSeries::EDGES, reader.get_field( t ).location );
+    CPPUNIT_ASSERT_EQUAL( (uint64_t) edges, reader.get_field( t ).count );
+    CPPUNIT_ASSERT_EQUAL( (uint64_t) 0, reader.get_field( t ).offset % TimeSeries::alignment );
+
+    for( unsigned f = 0; f < frames; f++ ) {
+        CPPUNIT_ASSERT_EQUAL( 0.5 * f, reader.time( f ) );
+        const double* pressure = reader.data< double >( f, p );
+        const double* ptrace = reader.data< double >( f, t );
+        CPPUNIT_ASSERT( pressure != nullptr && ptrace != nullptr );
+        CPPUNIT_ASSERT( reader.data< float >( f, p ) == nullptr );
+        for( IndexType i = 0; i < cells; i++ )
+            CPPUNIT_ASSERT_EQUAL( 1e5 + f * 100 + i + 0.25, pressure[ i ] );
+        for( IndexType i = 0; i < edges; i++ )
+            CPPUNIT_ASSERT_EQUAL( -( f * 100.0 + i ), ptrace[ i ] );
+    }
+}
+
+void test_time_series::test_float32( void )
+{
+    CPPUNIT_ASSERT( write_series( "test-series-float32.snap", TimeSeries::FLOAT32 ) );
+
+    TimeSeriesReader reader;
+    CPPUNIT_ASSERT( reader.open( "test-series-float32.snap" ) );
+    CPPUNIT_ASSERT_EQUAL( (uint32_t) TimeSeries::FLOAT32, reader.get_field( 0 ).type );
+    CPPUNIT_ASSERT( reader.data< double >( 0, 0 ) == nullptr );
+    const float* pressure = reader.data< float >( frames - 1, 0 );
+    CPPUNIT_ASSERT( pressure != nullptr );
+    for( IndexType i = 0; i < cells; i++ )
+        CPPUNIT_ASSERT_EQUAL( (float) ( 1e5 + ( frames - 1 ) * 100 + i + 0.25 ), pressure[ i ] );
+}
+
+void test_time_series::test_incomplete( void )
+{
+    TimeSeriesWriter writer;
+    CPPUNIT_ASSERT( writer.add_field( "pressure", TimeSeries::CELLS, cells ) );
+    CPPUNIT_ASSERT( writer.open( "test-series-incomplete.snap", 10.0, 10.0, rows, cols ) );
+    Vector pressure;
+    pressure.setSize( cells );
+    pressure.setAllElements( 1.0 );
+    CPPUNIT_ASSERT( writer.append( 0.0, { &pressure } ) );
+    // wrong number of fields
+    CPPUNIT_ASSERT( ! writer.append( 1.0, { &pressure, &pressure } ) );
+    // fields cannot be added to an open file
+    CPPUNIT_ASSERT( ! writer.add_field( "ptrace", TimeSeries::EDGES, edges ) );
+
+    // the index is written by close()
+    TimeSeriesReader reader;
+    CPPUNIT_ASSERT( ! reader.open( "test-series-incomplete.snap" ) );
+    CPPUNIT_ASSERT( writer.close() );
+    CPPUNIT_ASSERT( reader.open( "test-series-incomplete.snap" ) );
+    CPPUNIT_ASSERT_EQUAL( 1u, reader.num_frames() );
+}
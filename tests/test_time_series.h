@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "TimeSeries.h"
+
+using namespace CPPUNIT_NS;
+
+class test_time_series
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_time_series );
+    CPPUNIT_TEST( test_round_trip );
+    CPPUNIT_TEST( test_float32 );
+    CPPUNIT_TEST( test_incomplete );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_round_trip( void );
+    void test_float32( void );
+    void test_incomplete( void );
+};
@@ -0,0 +1,48 @@
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "test_trace.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( test_trace );
+
+
+static unsigned count_occurrences( const string & text, const string & pattern )
+{
+    unsigned count = 0;
+    for( size_t pos = text.find( pattern ); pos != string::npos; pos = text.find( pattern, pos + 1 ) )
+        count++;
+    return count;
+}
+
+void test_trace::test_write( void )
+{
+    {
+        Trace::Scope scope( "disabled" );
+    }
+
+    Trace::enable();
+    CPPUNIT_ASSERT( Trace::enabled() );
+    {
+        Trace::Scope scope( "outer" );
+        // two threads at the same time record into different buffers
+        thread a( [] () { Trace::Scope scope( "worker" ); this_thread::sleep_for( chrono::milliseconds( 5 ) ); } );
+        thread b( [] () { Trace::Scope scope( "worker" ); this_thread::sleep_for( chrono::milliseconds( 5 ) ); } );
+        a.join();
+        b.join();
+    }
+    CPPUNIT_ASSERT( Trace::write( "test-trace.json" ) );
+    CPPUNIT_ASSERT( ! Trace::enabled() );
+
+    ifstream file( "test-trace.json" );
+    stringstream ss;
+    ss << file.rdbuf();
+    const string json = ss.str();
+    CPPUNIT_ASSERT_EQUAL( 0u, count_occurrences( json, "\"disabled\"" ) );
+    CPPUNIT_ASSERT_EQUAL( 1u, count_occurrences( json, "\"name\":\"outer\",\"ph\":\"X\"" ) );
+    CPPUNIT_ASSERT_EQUAL( 2u, count_occurrences( json, "\"name\":\"worker\",\"ph\":\"X\"" ) );
+    CPPUNIT_ASSERT( count_occurrences( json, "\"thread_name\"" ) >= 3 );
+    CPPUNIT_ASSERT_EQUAL( '}', json[ json.size() - 2 ] );
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Trace.h"
+
+using namespace CPPUNIT_NS;
+
+class test_trace
+    : public TestFixture
+{
+    CPPUNIT_TEST_SUITE( test_trace );
+    CPPUNIT_TEST( test_write );
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void test_write( void );
+};